@@ -1,290 +1,377 @@
 ﻿#include <assert.h>
-#include <algorithm>
 #include "astar/astar.h"
-
-static const int kDefaultStepVal = 10;
-static const int kDefaultObliqueVal = 14;
-
-#define MIN(x,y) ((x)<(y) ? (x) : (y))
-#define MAX(x,y) ((x)>(y) ? (x) : (y))
-#define SAFE_DELETE(ptr) \
-    if ((ptr) != nullptr) { \
-        delete (ptr); \
-        (ptr) = nullptr; \
-    }
-
-AStar::AStar() :
-    stepVal_(kDefaultStepVal),
-    obliqueVal_(kDefaultObliqueVal),
+#include "astar/basicastar.h"
+#include "astar/bitgrid.h"
+#include "astar/chunkedgrid.h"
+#include "astar/costgrid.h"
+#include "astar/jumptable.h"
+#include "astar/landmarktable.h"
+#include "astar/occupancygrid.h"
+#include "astar/regionindex.h"
+
+const int AStar::SearchSpace::kPageShift;
+const int AStar::SearchSpace::kPageSize;
+const int AStar::SearchSpace::kPageMask;
+const size_t AStar::SearchSpace::kMaxCachedPages;
+
+AStar::SearchSpace::SearchSpace() :
     width_(0),
     height_(0),
-    canPass_(nullptr)
-{
-}
-
-AStar::~AStar()
+    generation_(0),
+    nodeLayout_(LAYOUT_TILED),
+    pagesPerRow_(0),
+    pageCount_(0),
+    openListMode_(OPENLIST_BINARY_HEAP),
+    openCount_(0),
+    bucketCursor_(0),
+    bucketUsed_(0)
 {
 }
 
-void AStar::Init(const Params &param)
+AStar::SearchSpace::~SearchSpace()
 {
-    width_ = param.width;
-    height_ = param.height;
-    canPass_ = param.canPass;
-    //mapping_.clear();
-    //mapping_.resize(width_ * height_, nullptr);
 }
 
-void AStar::Clear()
+void AStar::SearchSpace::Init(uint16_t width, uint16_t height, OpenListMode openListMode, NodeLayout nodeLayout)
 {
-    //for (auto &node : mapping_)
-    //{
-    //    SAFE_DELETE(node);
-    //}
+    // 上一次搜索可能中途放弃（ResumableAStar 重新 Start、PathScheduler 取消），开启列表里还留着旧节点
+    Clear();
+    openListMode_ = openListMode;
 
-    for (auto &kv : mapping2_)
+    // 地图尺寸或布局变化时才重建节点数组，按页分配时搜索过的页太多也全部释放
+    if (width_ != width || height_ != height || nodeLayout_ != nodeLayout || pageCount_ > kMaxCachedPages)
     {
-        SAFE_DELETE(kv.second);
+        generation_ = 0;
+        width_ = width;
+        height_ = height;
+        ResetLayout(nodeLayout);
     }
 
-    mapping2_.clear();
-    openList_.clear();
-    canPass_ = nullptr;
-    width_ = 0;
-    height_ = 0;
+    // 代数回绕时把所有节点清零，保证旧节点不会与新代数碰撞
+    if (++generation_ == 0)
+    {
+        for (auto &node : mapping_)
+        {
+            node.generation = 0;
+        }
+        for (auto &page : pages_)
+        {
+            for (size_t i = 0; page && i < pageLayout_.GetSize(); ++i)
+            {
+                page[i].generation = 0;
+            }
+        }
+        generation_ = 1;
+    }
 }
 
-// 获取节点在二叉堆上的索引
-bool AStar::__GetNodeIndex(std::vector<Node*> &heap, Node *node, size_t *index)
+void AStar::SearchSpace::ResetLayout(NodeLayout nodeLayout)
 {
-    *index = 0;
-    const size_t size = heap.size();
-    while (*index < size)
+    nodeLayout_ = nodeLayout;
+    mapping_.clear();
+    pages_.clear();
+    pageCount_ = 0;
+
+    // 页表只占每页一个指针，页在第一次访问时分配
+    if (nodeLayout_ == LAYOUT_PAGED)
     {
-        if (heap[*index]->pos == node->pos)
+        std::vector<Node>().swap(mapping_);
+        pageLayout_.Reset(kPageSize, kPageSize, GridLayout::kTileShift);
+        pagesPerRow_ = ((size_t)width_ + kPageMask) >> kPageShift;
+        pages_.resize(pagesPerRow_ * (((size_t)height_ + kPageMask) >> kPageShift));
+        return;
+    }
+
+    layout_.Reset(width_, height_, nodeLayout_ == LAYOUT_TILED ? GridLayout::kTileShift : 0);
+    mapping_.resize(layout_.GetSize());
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
         {
-            return true;
+            mapping_[layout_.Index(x, y)].pos.Reset(x, y);
         }
-        ++(*index);
     }
-    return false;
 }
 
-// 二叉堆上滤
-void AStar::__PercolateUp(std::vector<Node*> &heap, size_t index)
+void AStar::SearchSpace::AllocPage(std::unique_ptr<Node[]> &page, const Vec2 &pos)
 {
-    size_t parent = 0;
-    while (index > 0)
+    page.reset(new Node[pageLayout_.GetSize()]);
+    ++pageCount_;
+
+    const int originX = pos.x & ~kPageMask;
+    const int originY = pos.y & ~kPageMask;
+    for (int y = 0; y < kPageSize; ++y)
     {
-        parent = (index - 1) / 2;
-        if (heap[index]->f < heap[parent]->f)
-        {
-            std::swap(heap[index], heap[parent]);
-            index = parent;
-        }
-        else
+        for (int x = 0; x < kPageSize; ++x)
         {
-            return;
+            page[pageLayout_.Index(x, y)].pos.Reset((uint16_t)(originX + x), (uint16_t)(originY + y));
         }
     }
 }
 
-inline uint16_t AStar::CalcGValue(Node *parent, const Vec2 &current)
+void AStar::SearchSpace::Clear()
 {
-    uint16_t g = current.Distance(parent->pos) == 2 ? obliqueVal_ : stepVal_;
-    g += parent->g;
-    return g;
+    // 保留节点数组和列表容量供下次寻路复用
+    openList_.clear();
+    for (size_t i = 0; i < bucketUsed_; ++i)
+    {
+        buckets_[i].clear();
+    }
+    openCount_ = 0;
+    bucketCursor_ = 0;
+    bucketUsed_ = 0;
 }
 
-inline uint16_t AStar::CalcHValue(const Vec2 &current, const Vec2 &end)
+// 节点入堆
+void AStar::SearchSpace::PushOpenList(Node *node)
 {
-    uint16_t h = end.Distance(current);
-    return h * stepVal_;
+    node->state = IN_OPENLIST;
+    ++openCount_;
+    if (openListMode_ == OPENLIST_BUCKET)
+    {
+        PushBucket(node);
+        return;
+    }
+
+    node->heapIndex = (uint32_t)openList_.size();
+    openList_.push_back(node);
+    __PercolateUp(openList_, node->heapIndex);
 }
 
-inline bool AStar::InOpenList(const Vec2 &pos, Node *&outNode)
+// 弹出f值最小的节点（堆顶）
+AStar::SearchSpace::Node* AStar::SearchSpace::PopOpenList()
 {
-    outNode = __GetMappingNode(pos);
-    return outNode ? outNode->state == IN_OPENLIST : false;
+    --openCount_;
+    if (openListMode_ == OPENLIST_BUCKET)
+    {
+        Node *top = TopBucket();
+        buckets_[bucketCursor_].pop_back();
+        return top;
+    }
+
+    Node *top = openList_.front();
+    openList_.front() = openList_.back();
+    openList_.front()->heapIndex = 0;
+    openList_.pop_back();
+    if (!openList_.empty())
+    {
+        __PercolateDown(openList_, 0);
+    }
+    return top;
 }
 
-inline bool AStar::InCloseList(const Vec2 &pos)
+AStar::SearchSpace::Node* AStar::SearchSpace::TopOpenList()
 {
-    Node *node = __GetMappingNode(pos);
-    return node ? node->state == IN_CLOSELIST : false;
+    return openListMode_ == OPENLIST_BUCKET ? TopBucket() : openList_.front();
 }
 
-bool AStar::IsValidPos(const Vec2 &pos) const
+void AStar::SearchSpace::UpdateOpenList(Node *node)
 {
-    return (pos.x >= 0 && pos.x < width_ && pos.y >= 0 && pos.y < height_);
+    if (openListMode_ == OPENLIST_BUCKET)
+    {
+        // 旧的记录留在原来的桶里，出队时发现f值不符再跳过
+        PushBucket(node);
+        return;
+    }
+
+    assert(openList_[node->heapIndex] == node);
+    __PercolateUp(openList_, node->heapIndex);
 }
 
-bool AStar::CanPass(const Vec2 &pos) const
+// 二叉堆上滤
+void AStar::SearchSpace::__PercolateUp(std::vector<Node*> &heap, size_t index)
 {
-    return IsValidPos(pos) ? canPass_(pos) : false;
+    Node *node = heap[index];
+    while (index > 0)
+    {
+        const size_t parent = (index - 1) / 2;
+        if (!__Less(node, heap[parent]))
+        {
+            break;
+        }
+
+        heap[index] = heap[parent];
+        heap[index]->heapIndex = (uint32_t)index;
+        index = parent;
+    }
+    heap[index] = node;
+    node->heapIndex = (uint32_t)index;
 }
 
-bool AStar::CanPass(const Vec2 &current, const Vec2 &destination, bool corner)
+// 二叉堆下滤
+void AStar::SearchSpace::__PercolateDown(std::vector<Node*> &heap, size_t index)
 {
-    if (IsValidPos(destination))
+    Node *node = heap[index];
+    const size_t size = heap.size();
+    while (true)
     {
-        if (InCloseList(destination))
+        size_t child = index * 2 + 1;
+        if (child >= size)
         {
-            return false;
+            break;
         }
 
-        if (destination.Distance(current) == 1)
+        if (child + 1 < size && __Less(heap[child + 1], heap[child]))
         {
-            return canPass_(destination);
+            ++child;
         }
-        else if (corner)
+
+        if (!__Less(heap[child], node))
         {
-            return canPass_(destination)
-                && CanPass(Vec2(destination.x, current.y))
-                && CanPass(Vec2(current.x, destination.y));
+            break;
         }
+
+        heap[index] = heap[child];
+        heap[index]->heapIndex = (uint32_t)index;
+        index = child;
     }
-    return false;
+    heap[index] = node;
+    node->heapIndex = (uint32_t)index;
 }
 
-void AStar::FindCanPassNearbyNodes(const Vec2 &current, bool corner, std::vector<Vec2> *outList)
+void AStar::SearchSpace::PushBucket(Node *node)
 {
-    Vec2 destination;
-    const int maxRow = MIN(current.y + 1, height_ - 1);
-    const int maxCol = MIN(current.x + 1, width_ -1);
-
-    int rowIndex = MAX(current.y - 1, 0);
-    while (rowIndex <= maxRow)
+    const size_t f = node->f;
+    if (f >= buckets_.size())
     {
-        int colIndex = MAX(current.x - 1, 0);
-        while (colIndex <= maxCol)
-        {
-            destination.Reset(colIndex, rowIndex);
-            if (CanPass(current, destination, corner))
-            {
-                outList->push_back(destination);
-            }
-            ++colIndex;
-        }
-        ++rowIndex;
+        buckets_.resize(f + 1);
+    }
+    if (f >= bucketUsed_)
+    {
+        bucketUsed_ = f + 1;
+    }
+    // 估价函数不一致时f值可能比当前最小桶更小
+    if (f < bucketCursor_)
+    {
+        bucketCursor_ = f;
     }
+    buckets_[f].push_back(node);
 }
 
-void AStar::HandleFoundInOpenList(Node *current, Node *destination)
+// 丢弃旧记录，返回最小桶的最后一个节点
+AStar::SearchSpace::Node* AStar::SearchSpace::TopBucket()
 {
-    uint16_t g = CalcGValue(current, destination->pos);
-    if (g < destination->g)
+    while (true)
     {
-        destination->g = g;
-        destination->f = destination->g + destination->h;
-        destination->parent = current;
-
-        size_t index = 0;
-        if (__GetNodeIndex(openList_, destination, &index))
+        std::vector<Node*> &bucket = buckets_[bucketCursor_];
+        if (bucket.empty())
         {
-            __PercolateUp(openList_, index);
+            ++bucketCursor_;
+            continue;
         }
-        else
+
+        // 跳过已经出队或f值已经变小的旧记录
+        Node *node = bucket.back();
+        if (node->state == IN_OPENLIST && node->f == bucketCursor_)
         {
-            assert(false);
+            return node;
         }
+        bucket.pop_back();
     }
 }
 
-void AStar::HandleNotFoundInOpenList(Node *current, Node *destination, const Vec2 &end)
+template<typename CanPass, typename MovePolicy>
+static std::vector<AStar::Vec2> __Find(AStar::SearchSpace &space, AStar::SearchSpace &backSpace, const CanPass &canPass, const AStar::Params &param)
 {
-    destination->parent = current;
-    destination->g = CalcGValue(current, destination->pos);
-    destination->h = CalcHValue(destination->pos, end);
-    destination->f = destination->g + destination->h;
+    return DispatchHeuristic<MovePolicy>(param.heuristic, [&](auto heuristic) {
+        return BasicAStar<CanPass, MovePolicy, decltype(heuristic)>(space, canPass, &backSpace).Find(param);
+    });
+}
 
-    __SetMappingNode(destination);
+template<typename CanPass>
+static std::vector<AStar::Vec2> __Find(AStar::SearchSpace &space, AStar::SearchSpace &backSpace, const CanPass &canPass, const AStar::Params &param)
+{
+    return param.corner
+        ? __Find<CanPass, EightWayMove>(space, backSpace, canPass, param)
+        : __Find<CanPass, FourWayMove>(space, backSpace, canPass, param);
+}
 
-    destination->state = IN_OPENLIST;
-    openList_.push_back(destination);
-    std::push_heap(openList_.begin(), openList_.end(), NodeHeapCmp);
+// 设置了占用层时叠加到静态地图上
+template<typename CanPass>
+static std::vector<AStar::Vec2> __FindOnLayers(AStar::SearchSpace &space, AStar::SearchSpace &backSpace, const CanPass &canPass, const AStar::Params &param)
+{
+    return param.occupancy
+        ? __Find(space, backSpace, OccupancyCanPass<CanPass>(canPass, *param.occupancy, param), param)
+        : __Find(space, backSpace, canPass, param);
 }
 
-AStar::Node* AStar::__GetMappingNode(const Vec2 &pos) const
+AStar::AStar()
 {
-    //return mapping_[pos.y * width_ + pos.x];
-    auto iter = mapping2_.find(pos.y * width_ + pos.x);
-    return iter != mapping2_.end() ? iter->second : nullptr;
 }
 
-void AStar::__SetMappingNode(Node *node)
+AStar::~AStar()
 {
-    //mapping_[node->pos.y * width_ + node->pos.x] = node;
-    mapping2_[node->pos.y * width_ + node->pos.x] = node;
 }
 
-std::vector<AStar::Vec2> AStar::Find(const Params &param)
+bool AStar::Params::IsMapMatched() const
 {
-    std::vector<Vec2> paths;
-    if (!param.IsValid())
+    if (mode == SEARCH_JPS_PLUS && (jumpTable == nullptr || !jumpTable->Match(width, height, corner)))
     {
-        assert(false);
-        return paths;
+        return false;
     }
 
-    Init(param);
+    if (passGrid && (passGrid->GetWidth() != width || passGrid->GetHeight() != height))
+    {
+        return false;
+    }
 
-    // 将起点放入开启列表
-    Node *startNode = new Node(param.start);
-    startNode->state = IN_OPENLIST;
-    openList_.push_back(startNode);
+    if (chunkGrid && (chunkGrid->GetWidth() != width || chunkGrid->GetHeight() != height))
+    {
+        return false;
+    }
 
-    __SetMappingNode(startNode);
+    if (costGrid && (costGrid->GetWidth() != width || costGrid->GetHeight() != height))
+    {
+        return false;
+    }
+
+    if (regionIndex && (regionIndex->GetWidth() != width || regionIndex->GetHeight() != height))
+    {
+        return false;
+    }
 
-    // 寻路操作
-    std::vector<Vec2> nearbyNodes;
-    nearbyNodes.reserve(param.corner ? 8 : 4);
+    if (landmarks && !landmarks->Match(width, height, corner))
+    {
+        return false;
+    }
 
-    while (!openList_.empty())
+    if (occupancy && (occupancy->GetWidth() != width || occupancy->GetHeight() != height))
     {
-        // 找出f值最小的节点（最小堆的根节点）
-        Node *current = openList_.front();
-        std::pop_heap(openList_.begin(), openList_.end(), NodeHeapCmp);
-        openList_.pop_back();
+        return false;
+    }
 
-        current->state = IN_CLOSELIST; // 放到关闭列表
+    return true;
+}
 
-        // 是否找到终点
-        if (current->pos == param.end)
-        {
-            while (current->parent)
-            {
-                paths.push_back(current->pos);
-                current = current->parent;
-            }
-            std::reverse(paths.begin(), paths.end());
-            goto __end__;
-        }
+std::vector<AStar::Vec2> AStar::Find(const Params &param)
+{
+    if (!param.IsValid() || !param.IsMapMatched())
+    {
+        assert(false);
+        return std::vector<Vec2>();
+    }
 
-        // 查找周围可通过的节点
-        nearbyNodes.clear();
-        FindCanPassNearbyNodes(current->pos, param.corner, &nearbyNodes);
+    if (param.costGrid)
+    {
+        return __FindOnLayers(space_, backSpace_, CostGridCanPass(*param.costGrid), param);
+    }
 
-        // 计算周围节点的估值
-        size_t index = 0;
-        const size_t size = nearbyNodes.size();
-        while (index < size)
-        {
-            Node *nextNode = nullptr;
-            if (InOpenList(nearbyNodes[index], nextNode))
-            {
-                HandleFoundInOpenList(current, nextNode);
-            }
-            else
-            {
-                nextNode = new Node(nearbyNodes[index]);
-                HandleNotFoundInOpenList(current, nextNode, param.end);
-            }
-            ++index;
-        }
+    if (param.chunkGrid)
+    {
+        return __FindOnLayers(space_, backSpace_, ChunkedGridCanPass(*param.chunkGrid), param);
     }
 
-__end__:
-    Clear();
-    return paths;
+    if (param.passGrid)
+    {
+        return __FindOnLayers(space_, backSpace_, BitGridCanPass(*param.passGrid), param);
+    }
+
+    return __FindOnLayers(space_, backSpace_, CallbackCanPass<CanPassFunc>(param.canPass, param.width, param.height), param);
+}
+
+std::vector<AStar::Vec2> AStar::FindNearest(const Params &param, const std::vector<Vec2> &goals)
+{
+    Params nearestParam = param;
+    nearestParam.goals = &goals;
+    return Find(nearestParam);
 }
@@ -1,18 +1,29 @@
 ﻿#pragma once
 #include <stdint.h>
+#include <stdlib.h>
 #include <functional>
+#include <memory>
 #include <vector>
-#include <map>
+#include "astar/gridlayout.h"
 
 /**
 * A星寻路算法原理参考：
 * http://www.cppblog.com/christanxw/archive/2006/04/07/5126.html
 * 
-* 可优化：
-* #.使用对象池或内存池优化节点的内存分配
-* #.使用专门的堆容器代替目前的堆实现或优化 __GetNodeIndex 避免里面的遍历
+* Params 选择搜索方式（逐格、JPS/JPS+、双向）、可通过性的来源（canPass、BitGrid、ChunkedGrid、CostGrid）
+* 以及可选的占用层、加速结构和搜索限制，合法的组合由 Params::IsValid 检查。
+* 节点数组和开启列表（SearchSpace）跨 Find 调用复用，每次寻路的初始化开销为 O(1)。
+* 搜索过程实现在模板 BasicAStar（astar/basicastar.h）中，AStar 根据 Params 选择对应的模板实例。
 */
 
+class BitGrid;
+class ChunkedGrid;
+class CostGrid;
+class JumpTable;
+class LandmarkTable;
+class OccupancyGrid;
+class RegionIndex;
+
 class AStar final
 {
 public:
@@ -48,6 +59,59 @@ public:
     //typedef std::function<bool(const Vec2&)> CanPassFunc;
     using CanPassFunc = std::function<bool(const Vec2&)>;
 
+    /**
+     * 搜索方式
+     */
+    enum SearchMode
+    {
+        SEARCH_ASTAR, //普通A星，逐格扩展
+        SEARCH_JPS, //跳点搜索
+        SEARCH_JPS_PLUS, //使用预计算跳跃距离（JumpTable）的跳点搜索
+        SEARCH_BIDIRECTIONAL, //同时从起点和终点逐格扩展，在中间相遇
+    };
+
+    /**
+     * 估价函数
+     */
+    enum HeuristicMode
+    {
+        HEURISTIC_AUTO, //按移动方式选择：4方向为曼哈顿距离，8方向为对角距离
+        HEURISTIC_MANHATTAN, //曼哈顿距离，8方向时会高估，路径不一定最短
+        HEURISTIC_OCTILE, //对角距离，8方向时在无障碍地图上准确
+        HEURISTIC_CHEBYSHEV, //切比雪夫距离，比对角距离小
+        HEURISTIC_EUCLIDEAN, //欧几里得距离，比对角距离小
+    };
+
+    /**
+     * 开启列表的实现
+     */
+    enum OpenListMode
+    {
+        OPENLIST_BINARY_HEAP, //带索引的二叉堆，O(log n)
+        OPENLIST_BUCKET, //按f值分桶，入队和出队均摊 O(1)，同一f值后进先出，不比较h值；桶数随f值增长，代价较大时应使用二叉堆
+    };
+
+    /**
+     * 节点数组的布局
+     */
+    enum NodeLayout
+    {
+        LAYOUT_TILED, //按 8x8 分块，上下相邻的节点在同一块内
+        LAYOUT_ROW_MAJOR, //按行平铺，上下相邻的节点相隔整行
+        LAYOUT_PAGED, //按 64x64 分页，只为搜索到的页分配节点，用于无法分配 width*height 个节点的超大地图
+    };
+
+    /**
+     * 分步搜索的结果
+     */
+    enum StepResult
+    {
+        STEP_PENDING, //尚未完成，可以继续搜索
+        STEP_FOUND, //找到路径
+        STEP_FAILED, //终点不可达或参数错误
+        STEP_PARTIAL, //达到 Params 的 maxExpansions 或 maxRadius 限制，路径通向离终点估价最小的已扩展节点
+    };
+
     /**
      * 搜索参数
      */
@@ -59,52 +123,189 @@ public:
         Vec2 start; //起点坐标
         Vec2 end; //终点坐标
         CanPassFunc canPass; //是否可通过
+        SearchMode mode; //搜索方式
+        const JumpTable *jumpTable; //SEARCH_JPS_PLUS 使用的跳跃距离表
+        const BitGrid *passGrid; //可选，按位存储的可通过性
+        const ChunkedGrid *chunkGrid; //可选，分块加载的可通过性
+        const CostGrid *costGrid; //可选，每个格子的移动代价
+        const std::vector<Vec2> *goals; //可选，多个终点，找离起点最近的一个
+        const OccupancyGrid *occupancy; //可选，动态占用层
+        uint16_t occupancyRadius; //占用层只在起点附近生效的半径，0 表示全图
+        const RegionIndex *regionIndex; //可选，连通区域索引
+        const LandmarkTable *landmarks; //可选，地标距离表
+        HeuristicMode heuristic; //估价函数
+        OpenListMode openList; //开启列表的实现
+        NodeLayout nodeLayout; //节点数组的布局
+        size_t maxExpansions; //可选，最多扩展的节点数
+        uint16_t maxRadius; //可选，只搜索与起点横向和纵向距离都不超过它的格子
+        bool smooth; //只返回拐点
 
-        Params() : corner(false), width(0), height(0) {}
+        Params() : corner(false), width(0), height(0), mode(SEARCH_ASTAR), jumpTable(nullptr), passGrid(nullptr), chunkGrid(nullptr), costGrid(nullptr), goals(nullptr), occupancy(nullptr), occupancyRadius(0), regionIndex(nullptr), landmarks(nullptr), heuristic(HEURISTIC_AUTO), openList(OPENLIST_BINARY_HEAP), nodeLayout(LAYOUT_TILED), maxExpansions(0), maxRadius(0), smooth(false) {}
 
         bool IsValid() const
         {
-            return (canPass != nullptr
+            return ((canPass != nullptr || passGrid != nullptr || chunkGrid != nullptr || costGrid != nullptr)
+                && (mode != SEARCH_JPS_PLUS || jumpTable != nullptr)
+                && (costGrid == nullptr || ((mode == SEARCH_ASTAR || mode == SEARCH_BIDIRECTIONAL) && landmarks == nullptr && !smooth && chunkGrid == nullptr))
+                && (goals == nullptr || (mode == SEARCH_ASTAR && !goals->empty()))
+                && (mode == SEARCH_ASTAR || (maxExpansions == 0 && maxRadius == 0))
+                && (occupancy == nullptr || mode != SEARCH_JPS_PLUS)
                 && width > 0 && height > 0
                 && end.x >= 0 && end.x < width
                 && end.y >= 0 && end.y < height
                 && start.x >= 0 && start.x < width
                 && start.y >= 0 && start.y < height);
         }
-    };
 
-private:
-    /**
-     * 路径节点状态
-     */
-    enum NodeState
-    {
-        UNKNOWN, //未知
-        IN_OPENLIST, //在开启列表（待搜索）
-        IN_CLOSELIST, //在关闭列表（已搜索）
+        /**
+         * jumpTable、passGrid、chunkGrid、costGrid、occupancy、regionIndex 和 landmarks 是否与地图尺寸、corner 一致
+         */
+        bool IsMapMatched() const;
     };
 
     /**
-     * 路径节点
+     * 搜索空间：按格子存放的节点数组和开启列表，可以跨多次搜索复用
+     *
+     * 每个节点记录最后一次被访问时的搜索代数，开始新的搜索只需递增代数，旧节点在首次访问时才重置。
+     * 开启列表默认是带索引的二叉最小堆，f值相同时优先扩展h值小的节点；
+     * 也可以按f值分桶，更新g值时把节点再放入新的桶，旧的记录在出队时跳过。
      */
-    struct Node
+    class SearchSpace final
     {
-        uint16_t f; // f = g + h
-        uint16_t g; // 与起点的距离
-        uint16_t h; // 与终点的估算距离
-        Vec2 pos; // 节点的位置
-        NodeState state; // 节点的状态
-        Node* parent; // 父节点
-
-        Node(const Vec2 &pos)
-            : f(0), g(0), h(0), pos(pos), state(UNKNOWN), parent(nullptr)
+    public:
+        /**
+         * 路径节点状态
+         */
+        enum NodeState
+        {
+            UNKNOWN, //未知
+            IN_OPENLIST, //在开启列表（待搜索）
+            IN_CLOSELIST, //在关闭列表（已搜索）
+        };
+
+        /**
+         * 路径节点
+         */
+        struct Node
         {
+            Node* parent; // 父节点
+            uint32_t f; // f = g + h
+            uint32_t g; // 与起点的距离
+            uint32_t h; // 与终点的估算距离
+            uint32_t heapIndex; // 在开启列表（二叉堆）上的索引
+            uint32_t generation; // 最后一次访问该节点的搜索代数
+            Vec2 pos; // 节点的位置
+            uint8_t state; // 节点的状态（NodeState）
+
+            Node()
+                : parent(nullptr), f(0), g(0), h(0), heapIndex(0), generation(0), state(UNKNOWN)
+            {
+            }
+
+            void Reset()
+            {
+                f = g = h = 0;
+                state = UNKNOWN;
+                heapIndex = 0;
+                parent = nullptr;
+            }
+        };
+
+    public:
+        SearchSpace();
+        ~SearchSpace();
+
+        /**
+         * 开始新的搜索，地图尺寸或布局变化时才重建节点数组
+         */
+        void Init(uint16_t width, uint16_t height, OpenListMode openListMode = OPENLIST_BINARY_HEAP, NodeLayout nodeLayout = LAYOUT_TILED);
+
+        /**
+         * 结束搜索，保留节点数组和开启列表的容量
+         */
+        void Clear();
+
+        /**
+         * 获取节点，本次搜索第一次访问时重置节点状态
+         */
+        Node* GetNode(const Vec2 &pos)
+        {
+            Node *node = nodeLayout_ == LAYOUT_PAGED ? GetPagedNode(pos) : &mapping_[layout_.Index(pos.x, pos.y)];
+            if (node->generation != generation_)
+            {
+                node->Reset();
+                node->generation = generation_;
+            }
+            return node;
         }
-    };
 
-    using NodeHeapCmpType = std::function<bool(const Node *a, const Node *b)>;
-    NodeHeapCmpType NodeHeapCmp = [](const Node *a, const Node *b)->bool {
-        return a->f > b->f;
+        bool IsOpenListEmpty() const { return openCount_ == 0; }
+        size_t GetOpenListSize() const { return openCount_; }
+
+        void PushOpenList(Node *node);
+        Node* PopOpenList();
+
+        /**
+         * f值最小的节点，不出队
+         */
+        Node* TopOpenList();
+
+        /**
+         * 节点的f值变小后调整其在开启列表中的位置
+         */
+        void UpdateOpenList(Node *node);
+
+    private:
+        // f值相同时h值小的优先
+        static_assert(sizeof(Node) <= 64, "Node should fit in one cache line");
+
+        static bool __Less(const Node *a, const Node *b)
+        {
+            return a->f < b->f || (a->f == b->f && a->h < b->h);
+        }
+
+        static void __PercolateUp(std::vector<Node*> &heap, size_t index);
+        static void __PercolateDown(std::vector<Node*> &heap, size_t index);
+
+        void PushBucket(Node *node);
+        Node* TopBucket();
+
+        Node* GetPagedNode(const Vec2 &pos)
+        {
+            std::unique_ptr<Node[]> &page = pages_[(size_t)(pos.y >> kPageShift) * pagesPerRow_ + (pos.x >> kPageShift)];
+            if (!page)
+            {
+                AllocPage(page, pos);
+            }
+            return &page[pageLayout_.Index(pos.x & kPageMask, pos.y & kPageMask)];
+        }
+
+        void AllocPage(std::unique_ptr<Node[]> &page, const Vec2 &pos);
+        void ResetLayout(NodeLayout nodeLayout);
+
+    private:
+        static const int kPageShift = 6; // 每页 64x64 个节点
+        static const int kPageSize = 1 << kPageShift;
+        static const int kPageMask = kPageSize - 1;
+        static const size_t kMaxCachedPages = 1024; // 开始新的搜索时页数超过它就全部释放
+
+    private:
+        uint16_t width_;
+        uint16_t height_;
+        uint32_t generation_; // 当前搜索代数，节点代数与之不同即视为未访问
+        NodeLayout nodeLayout_;
+        GridLayout layout_;
+        std::vector<Node> mapping_; // 按 layout_ 存放的节点数组，LAYOUT_PAGED 时为空
+        GridLayout pageLayout_; // 页内节点的布局
+        size_t pagesPerRow_;
+        size_t pageCount_; // 已分配的页数
+        std::vector<std::unique_ptr<Node[]>> pages_; // LAYOUT_PAGED 时的页表，未访问的页为空
+        OpenListMode openListMode_;
+        size_t openCount_; // 开启列表中的节点数
+        std::vector<Node*> openList_; // 按节点f值比较的最小堆
+        std::vector<std::vector<Node*>> buckets_; // 按f值分桶，桶内可能有f值已经变小的旧记录
+        size_t bucketCursor_; // 不小于它的桶才可能非空
+        size_t bucketUsed_; // 本次搜索用到的桶数，结束时只清理这些桶
     };
 
 public:
@@ -112,40 +313,19 @@ public:
     ~AStar();
 
 public:
+    /**
+     * 找不到路径时返回空，设置了 maxExpansions 或 maxRadius 时可能返回通向离终点最近的节点的部分路径
+     */
     std::vector<Vec2> Find(const Params &param);
 
-private:
-    void Init(const Params &param);
-    void Clear();
-
-private:
-    static bool __GetNodeIndex(std::vector<Node*> &heap, Node *node, size_t *index);
-    static void __PercolateUp(std::vector<Node*> &heap, size_t index);
-
-    uint16_t CalcGValue(Node *parent, const Vec2 &current);
-    uint16_t CalcHValue(const Vec2 &current, const Vec2 &end);
-
-    bool InOpenList(const Vec2 &pos, Node *&outNode);
-    bool InCloseList(const Vec2 &pos);
-    bool IsValidPos(const Vec2 &pos) const;
-    bool CanPass(const Vec2 &pos) const;
-    bool CanPass(const Vec2 &current, const Vec2 &destination, bool corner);
-
-    void FindCanPassNearbyNodes(const Vec2 &current, bool corner, std::vector<Vec2> *outList);
-    void HandleFoundInOpenList(Node *current, Node *destination);
-    void HandleNotFoundInOpenList(Node *current, Node *destination, const Vec2 &end);
-
-    Node* __GetMappingNode(const Vec2 &pos) const;
-    void __SetMappingNode(Node *node);
+    /**
+     * 一次搜索找到离起点最近的可到达终点，路径的最后一个点就是该终点
+     * 起点就是终点之一时返回空路径，与 Find 中起点和终点相同时一致
+     * 估价取到各个终点的最小值，终点很多时每个节点的估价开销随之增加
+     */
+    std::vector<Vec2> FindNearest(const Params &param, const std::vector<Vec2> &goals);
 
 private:
-    int stepVal_; // 到相邻正交格子的g值
-    int obliqueVal_; // 到相邻斜角格子的g值
-
-    uint16_t width_;
-    uint16_t height_;
-    CanPassFunc canPass_;
-    //std::vector<Node*> mapping_;
-    std::map<size_t, Node*> mapping2_;
-    std::vector<Node*> openList_; // 按节点f值比较的最小堆
+    SearchSpace space_;
+    SearchSpace backSpace_; // 双向搜索从终点出发的一侧，只在 SEARCH_BIDIRECTIONAL 时分配节点
 };
@@ -0,0 +1,1191 @@
+﻿#pragma once
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+#include "astar/astar.h"
+#include "astar/bitgrid.h"
+#include "astar/chunkedgrid.h"
+#include "astar/costgrid.h"
+#include "astar/jumptable.h"
+#include "astar/landmarktable.h"
+#include "astar/occupancygrid.h"
+#include "astar/regionindex.h"
+
+/**
+* 模板化的A星寻路
+*
+* 可通过性判断（CanPass）、移动方式（MovePolicy）和估价函数（Heuristic）都是模板参数，
+* 编译器可以内联可通过性判断，并为4方向和8方向分别生成展开后的循环。
+* AStar 是它的一层包装，按 Params 选择对应的实例。
+*
+* CanPass 需要提供：
+*   static const bool kWeighted; // 是否按格子代价计算g值
+*   bool operator()(int x, int y) const; // 地图外返回 false
+*   uint32_t GetNeighborhood(int x, int y, uint32_t mask) const; // 3x3 邻域中 mask 指定的格子是否可通过
+*   int GetCost(int x, int y) const; // 格子的代价，CostGrid::kDefaultCost 为普通地面
+*   int GetMinCost() const; // 可通过格子中最小的代价
+* MovePolicy 需要提供：
+*   static const bool kCorner; // 是否允许斜角移动
+*   static const uint32_t kNeighborMask; // 需要读取的邻域格子
+*   static uint32_t GetMoves(uint32_t cells); // 由邻域可通过性得到可走的方向
+* Heuristic 需要提供：
+*   static uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end, int stepVal, int obliqueVal);
+*   不高估时找到的路径最短，Params::heuristic 通过 DispatchHeuristic 选择对应的实例。
+*
+* 3x3 邻域按位表示，第 (dy+1)*3+(dx+1) 位对应(x+dx,y+dy)。
+*/
+
+/**
+* 包装任意 bool(const AStar::Vec2&) 回调，传入 lambda 时可被内联
+*/
+template<typename Func>
+class CallbackCanPass final
+{
+public:
+    static const bool kWeighted = false;
+
+    CallbackCanPass(const Func &func, uint16_t width, uint16_t height)
+        : func_(func), width_(width), height_(height)
+    {
+    }
+
+    bool operator()(int x, int y) const
+    {
+        return (x >= 0 && x < width_ && y >= 0 && y < height_) ? func_(AStar::Vec2(x, y)) : false;
+    }
+
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        uint32_t cells = 0;
+        for (int bit = 0; bit < 9; ++bit)
+        {
+            if ((mask & (1u << bit)) && (*this)(x + bit % 3 - 1, y + bit / 3 - 1))
+            {
+                cells |= 1u << bit;
+            }
+        }
+        return cells;
+    }
+
+    int GetCost(int x, int y) const { return CostGrid::kDefaultCost; }
+    int GetMinCost() const { return CostGrid::kDefaultCost; }
+
+private:
+    const Func &func_;
+    uint16_t width_;
+    uint16_t height_;
+};
+
+/**
+* 读取 BitGrid，一次取出整个 3x3 邻域
+*/
+class BitGridCanPass final
+{
+public:
+    static const bool kWeighted = false;
+
+    explicit BitGridCanPass(const BitGrid &grid) : grid_(grid) {}
+
+    bool operator()(int x, int y) const
+    {
+        return grid_.Get(x, y);
+    }
+
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        return grid_.GetNeighborhood(x, y) & mask;
+    }
+
+    int GetCost(int x, int y) const { return CostGrid::kDefaultCost; }
+    int GetMinCost() const { return CostGrid::kDefaultCost; }
+
+private:
+    const BitGrid &grid_;
+};
+
+/**
+* 读取 ChunkedGrid，块不在内存中时先加载
+*/
+class ChunkedGridCanPass final
+{
+public:
+    static const bool kWeighted = false;
+
+    explicit ChunkedGridCanPass(const ChunkedGrid &grid) : grid_(grid) {}
+
+    bool operator()(int x, int y) const
+    {
+        return grid_.Get(x, y);
+    }
+
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        return grid_.GetNeighborhood(x, y) & mask;
+    }
+
+    int GetCost(int x, int y) const { return CostGrid::kDefaultCost; }
+    int GetMinCost() const { return CostGrid::kDefaultCost; }
+
+private:
+    const ChunkedGrid &grid_;
+};
+
+/**
+* 读取 CostGrid，代价为 0 的格子不可通过
+*/
+class CostGridCanPass final
+{
+public:
+    static const bool kWeighted = true;
+
+    explicit CostGridCanPass(const CostGrid &grid) : grid_(grid) {}
+
+    bool operator()(int x, int y) const
+    {
+        return grid_.Get(x, y) != CostGrid::kBlocked;
+    }
+
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        return grid_.GetNeighborhood(x, y, mask);
+    }
+
+    int GetCost(int x, int y) const
+    {
+        return grid_.Get(x, y);
+    }
+
+    int GetMinCost() const
+    {
+        return grid_.GetMinCost();
+    }
+
+private:
+    const CostGrid &grid_;
+};
+
+/**
+* 在静态地图上叠加动态占用层，被占据的格子不可通过
+* 起点和终点上的单位（自己和目标）不算，设置了 goals 时每个终点都不算，
+* occupancyRadius 不为 0 时只考虑起点附近的格子
+*/
+template<typename CanPass>
+class OccupancyCanPass final
+{
+public:
+    static const bool kWeighted = CanPass::kWeighted;
+
+    OccupancyCanPass(const CanPass &canPass, const OccupancyGrid &occupancy, const AStar::Params &param)
+        : canPass_(canPass), occupancy_(occupancy), start_(param.start), end_(param.end), radius_(param.occupancyRadius), width_(param.width)
+    {
+        if (param.goals)
+        {
+            for (const auto &goal : *param.goals)
+            {
+                goalCells_.push_back((uint32_t)goal.y * width_ + goal.x);
+            }
+            std::sort(goalCells_.begin(), goalCells_.end());
+        }
+    }
+
+    bool operator()(int x, int y) const
+    {
+        return canPass_(x, y) && !(occupancy_.Get(x, y) && !IsIgnored(x, y));
+    }
+
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        const uint32_t cells = canPass_.GetNeighborhood(x, y, mask);
+        uint32_t occupied = occupancy_.GetNeighborhood(x, y) & cells;
+        if (occupied == 0)
+        {
+            return cells;
+        }
+
+        // 邻域里有单位时才逐个排除起点、终点和半径外的格子
+        for (uint32_t bits = occupied; bits != 0; bits &= bits - 1)
+        {
+            int bit = 0;
+            while (((bits >> bit) & 1) == 0)
+            {
+                ++bit;
+            }
+            if (IsIgnored(x + bit % 3 - 1, y + bit / 3 - 1))
+            {
+                occupied &= ~(1u << bit);
+            }
+        }
+        return cells & ~occupied;
+    }
+
+    int GetCost(int x, int y) const { return canPass_.GetCost(x, y); }
+    int GetMinCost() const { return canPass_.GetMinCost(); }
+
+private:
+    bool IsIgnored(int x, int y) const
+    {
+        return (x == start_.x && y == start_.y) || IsGoal(x, y)
+            || (radius_ > 0 && (abs(x - start_.x) > radius_ || abs(y - start_.y) > radius_));
+    }
+
+    // 设置了 goals 时不再使用 end
+    bool IsGoal(int x, int y) const
+    {
+        if (goalCells_.empty())
+        {
+            return x == end_.x && y == end_.y;
+        }
+        return std::binary_search(goalCells_.begin(), goalCells_.end(), (uint32_t)y * width_ + x);
+    }
+
+private:
+    CanPass canPass_;
+    const OccupancyGrid &occupancy_;
+    AStar::Vec2 start_;
+    AStar::Vec2 end_;
+    int radius_;
+    uint32_t width_;
+    std::vector<uint32_t> goalCells_; // 多个终点所在格子的下标，已排序
+};
+
+struct ManhattanHeuristic;
+struct OctileHeuristic;
+
+/**
+* 只能上下左右移动
+*/
+struct FourWayMove
+{
+    using DefaultHeuristic = ManhattanHeuristic;
+
+    static const bool kCorner = false;
+    static const uint32_t kNeighborMask = 0xAA; // 上(1) 左(3) 右(5) 下(7)
+
+    static uint32_t GetMoves(uint32_t cells)
+    {
+        return cells & kNeighborMask;
+    }
+};
+
+/**
+* 可以斜角移动，但不能穿过拐角：斜角要求两侧的正交格子也可通过
+*/
+struct EightWayMove
+{
+    using DefaultHeuristic = OctileHeuristic;
+
+    static const bool kCorner = true;
+    static const uint32_t kNeighborMask = 0x1EF; // 除中心外的8个格子
+
+    static uint32_t GetMoves(uint32_t cells)
+    {
+        uint32_t moves = cells & 0xAA;
+        moves |= cells & (cells >> 1) & (cells >> 3) & 0x01; // 左上
+        moves |= cells & (cells << 1) & (cells >> 3) & 0x04; // 右上
+        moves |= cells & (cells >> 1) & (cells << 3) & 0x40; // 左下
+        moves |= cells & (cells << 1) & (cells << 3) & 0x100; // 右下
+        return moves;
+    }
+};
+
+/**
+* 曼哈顿距离
+*/
+struct ManhattanHeuristic
+{
+    static uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end, int stepVal, int obliqueVal)
+    {
+        return (uint32_t)(end.Distance(pos) * stepVal);
+    }
+};
+
+/**
+* 对角距离：先走斜线再走直线，8方向时在无障碍地图上等于实际代价
+*/
+struct OctileHeuristic
+{
+    static uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end, int stepVal, int obliqueVal)
+    {
+        const int dx = abs(end.x - pos.x);
+        const int dy = abs(end.y - pos.y);
+        const int oblique = dx < dy ? dx : dy;
+        return (uint32_t)(oblique * obliqueVal + (dx + dy - 2 * oblique) * stepVal);
+    }
+};
+
+/**
+* 切比雪夫距离：按较远的一个轴计算步数，每步取正交和斜角中较小的代价
+*/
+struct ChebyshevHeuristic
+{
+    static uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end, int stepVal, int obliqueVal)
+    {
+        const int dx = abs(end.x - pos.x);
+        const int dy = abs(end.y - pos.y);
+        return (uint32_t)((dx > dy ? dx : dy) * (stepVal < obliqueVal ? stepVal : obliqueVal));
+    }
+};
+
+/**
+* 欧几里得距离
+* 斜角代价小于正交代价的 √2 倍时（如 14 和 10）按斜角代价缩小，保证不会高估
+*/
+struct EuclideanHeuristic
+{
+    static uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end, int stepVal, int obliqueVal)
+    {
+        const double dx = end.x - pos.x;
+        const double dy = end.y - pos.y;
+        const double obliqueScale = obliqueVal / 1.4142135623730951;
+        return (uint32_t)(sqrt(dx * dx + dy * dy) * (obliqueScale < stepVal ? obliqueScale : stepVal));
+    }
+};
+
+/**
+* 按 mode 选择估价函数，以对应类型的对象调用 func，返回 func 的结果
+* HEURISTIC_AUTO 使用 MovePolicy::DefaultHeuristic
+*/
+template<typename MovePolicy, typename Func>
+auto DispatchHeuristic(AStar::HeuristicMode mode, Func &&func) -> decltype(func(ManhattanHeuristic()))
+{
+    switch (mode)
+    {
+    case AStar::HEURISTIC_MANHATTAN:
+        return func(ManhattanHeuristic());
+    case AStar::HEURISTIC_OCTILE:
+        return func(OctileHeuristic());
+    case AStar::HEURISTIC_CHEBYSHEV:
+        return func(ChebyshevHeuristic());
+    case AStar::HEURISTIC_EUCLIDEAN:
+        return func(EuclideanHeuristic());
+    default:
+        return func(typename MovePolicy::DefaultHeuristic());
+    }
+}
+
+template<typename CanPass, typename MovePolicy, typename Heuristic = typename MovePolicy::DefaultHeuristic>
+class BasicAStar final
+{
+public:
+    using Vec2 = AStar::Vec2;
+    using Params = AStar::Params;
+    using SearchSpace = AStar::SearchSpace;
+    using Node = SearchSpace::Node;
+
+    static const int kDefaultStepVal = 10;
+    static const int kDefaultObliqueVal = 14;
+
+public:
+    /**
+     * space 可以在多个 BasicAStar 之间复用，但同一时刻只能有一个搜索使用
+     * backSpace 是双向搜索中从终点出发的一侧使用的搜索空间，只有 SEARCH_BIDIRECTIONAL 需要
+     */
+    BasicAStar(SearchSpace &space, const CanPass &canPass, SearchSpace *backSpace = nullptr)
+        : stepVal_(kDefaultStepVal), obliqueVal_(kDefaultObliqueVal), hStepVal_(kDefaultStepVal), hObliqueVal_(kDefaultObliqueVal), space_(space), backSpace_(backSpace), canPass_(canPass),
+        param_(nullptr), expandedCount_(0), closest_(nullptr), bestCost_(kNoPath), totalHValue_(0)
+    {
+    }
+
+    /**
+     * 寻路
+     * Params 中的 canPass、passGrid、chunkGrid 和 corner 不再使用，分别由模板参数 CanPass 和 MovePolicy 决定
+     */
+    std::vector<Vec2> Find(const Params &param)
+    {
+        std::vector<Vec2> paths;
+        if (Start(param))
+        {
+            Step(SIZE_MAX, &paths);
+        }
+        return paths;
+    }
+
+    /**
+     * 开始分步搜索，param 需保持有效直到搜索结束
+     */
+    bool Start(const Params &param)
+    {
+        param_ = nullptr;
+        expandedCount_ = 0;
+        closest_ = nullptr;
+        if (param.width == 0 || param.height == 0
+            || param.start.x >= param.width || param.start.y >= param.height
+            || param.end.x >= param.width || param.end.y >= param.height)
+        {
+            assert(false);
+            return false;
+        }
+
+        if (param.mode == AStar::SEARCH_JPS_PLUS
+            && (param.jumpTable == nullptr || !param.jumpTable->Match(param.width, param.height, MovePolicy::kCorner)))
+        {
+            assert(false);
+            return false;
+        }
+
+        if (param.landmarks && !param.landmarks->Match(param.width, param.height, MovePolicy::kCorner))
+        {
+            assert(false);
+            return false;
+        }
+
+        if (param.mode == AStar::SEARCH_BIDIRECTIONAL && backSpace_ == nullptr)
+        {
+            assert(false);
+            return false;
+        }
+
+        // 多个终点时只支持逐格扩展
+        if (param.goals && (param.goals->empty() || param.mode != AStar::SEARCH_ASTAR))
+        {
+            assert(false);
+            return false;
+        }
+
+        goalCells_.clear();
+        if (param.goals)
+        {
+            for (const Vec2 &goal : *param.goals)
+            {
+                if (goal.x >= param.width || goal.y >= param.height)
+                {
+                    assert(false);
+                    return false;
+                }
+                goalCells_.push_back((uint32_t)goal.y * param.width + goal.x);
+            }
+            std::sort(goalCells_.begin(), goalCells_.end());
+        }
+
+        // 跳点搜索和地标估价都假设每格代价相同
+        if (CanPass::kWeighted && (param.mode == AStar::SEARCH_JPS || param.mode == AStar::SEARCH_JPS_PLUS || param.landmarks))
+        {
+            assert(false);
+            return false;
+        }
+
+        // 估价按最小的格子代价缩放，保证不会高估
+        hStepVal_ = stepVal_;
+        hObliqueVal_ = obliqueVal_;
+        if (CanPass::kWeighted)
+        {
+            hStepVal_ = stepVal_ * canPass_.GetMinCost() / CostGrid::kDefaultCost;
+            hObliqueVal_ = obliqueVal_ * canPass_.GetMinCost() / CostGrid::kDefaultCost;
+        }
+
+        param_ = &param;
+        // 分块加载的地图通常大到无法分配所有节点
+        const AStar::NodeLayout nodeLayout = param.chunkGrid ? AStar::LAYOUT_PAGED : param.nodeLayout;
+        space_.Init(param.width, param.height, param.openList, nodeLayout);
+        if (param.mode == AStar::SEARCH_BIDIRECTIONAL)
+        {
+            backSpace_->Init(param.width, param.height, param.openList, nodeLayout);
+            bestCost_ = kNoPath;
+            totalHValue_ = CalcHValue(param.start, param.end);
+        }
+
+        // 起点和终点不连通时开启列表为空，第一次 Step 即返回失败；
+        // 设置了搜索限制时仍然搜索，返回朝终点前进的部分路径，扩展的节点数本来就有上限
+        if (param.regionIndex && param.maxExpansions == 0 && param.maxRadius == 0 && !IsGoalConnected(param))
+        {
+            return true;
+        }
+
+        // 将起点放入开启列表
+        Node *startNode = space_.GetNode(param.start);
+        if (param.mode == AStar::SEARCH_BIDIRECTIONAL)
+        {
+            startNode->h = startNode->f = (uint32_t)totalHValue_;
+        }
+        else
+        {
+            // 搜索范围受限时起点也参与比较离终点的远近
+            startNode->h = startNode->f = CalcGoalHValue(param.start);
+        }
+        space_.PushOpenList(startNode);
+
+        // 双向搜索同时从终点出发，终点不可通过时（起点与终点相同除外）不可达
+        if (param.mode == AStar::SEARCH_BIDIRECTIONAL)
+        {
+            if (param.start == param.end)
+            {
+                bestCost_ = 0;
+                meetPos_ = param.start;
+            }
+            if (canPass_(param.end.x, param.end.y))
+            {
+                Node *endNode = backSpace_->GetNode(param.end);
+                endNode->h = endNode->f = (uint32_t)totalHValue_;
+                backSpace_->PushOpenList(endNode);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 最多扩展 maxExpansions 个节点，找到路径时写入 outPaths
+     * 返回 STEP_PENDING 时可以继续调用，开启列表保存在 SearchSpace 中
+     */
+    AStar::StepResult Step(size_t maxExpansions, std::vector<Vec2> *outPaths)
+    {
+        if (param_ == nullptr)
+        {
+            return AStar::STEP_FAILED;
+        }
+
+        const Params &param = *param_;
+        if (param.mode == AStar::SEARCH_BIDIRECTIONAL)
+        {
+            return StepBidirectional(maxExpansions, outPaths);
+        }
+
+        Node *nearbyNodes[JumpTable::DIR_COUNT];
+        for (size_t expansions = 0; expansions < maxExpansions; ++expansions)
+        {
+            if (space_.IsOpenListEmpty()
+                || (param.maxExpansions > 0 && expandedCount_ >= param.maxExpansions))
+            {
+                return FinishPartial(outPaths);
+            }
+
+            // 找出f值最小的节点（最小堆的根节点）
+            Node *current = space_.PopOpenList();
+            ++expandedCount_;
+
+            current->state = SearchSpace::IN_CLOSELIST; // 放到关闭列表
+
+            // 是否找到终点
+            if (IsGoal(current->pos))
+            {
+                BuildPath(current, outPaths);
+                if (param.smooth)
+                {
+                    SmoothPath(param.start, outPaths);
+                }
+                Finish();
+                return AStar::STEP_FOUND;
+            }
+
+            if (closest_ == nullptr || current->h < closest_->h || (current->h == closest_->h && current->g < closest_->g))
+            {
+                closest_ = current;
+            }
+
+            // 查找周围可通过的节点
+            const int count = param.mode == AStar::SEARCH_ASTAR
+                ? FindCanPassNearbyNodes(space_, current->pos, nearbyNodes)
+                : FindJumpPoints(current, param, nearbyNodes);
+
+            // 计算周围节点的估值
+            for (int index = 0; index < count; ++index)
+            {
+                Node *nextNode = nearbyNodes[index];
+                if (param.maxRadius > 0 && !IsInRadius(nextNode->pos, param))
+                {
+                    continue;
+                }
+
+                if (nextNode->state == SearchSpace::IN_OPENLIST)
+                {
+                    HandleFoundInOpenList(space_, current, nextNode);
+                }
+                else
+                {
+                    HandleNotFoundInOpenList(space_, current, nextNode, CalcGoalHValue(nextNode->pos));
+                }
+            }
+        }
+
+        return AStar::STEP_PENDING;
+    }
+
+    /**
+     * 本次搜索已扩展的节点数
+     */
+    size_t GetExpandedCount() const { return expandedCount_; }
+
+private:
+    static const int kNoPath = INT32_MAX / 2;
+
+    void Finish()
+    {
+        if (param_ && param_->mode == AStar::SEARCH_BIDIRECTIONAL)
+        {
+            backSpace_->Clear();
+        }
+        param_ = nullptr;
+        space_.Clear();
+    }
+
+    /**
+     * 没有找到终点：设置了搜索限制时返回到已扩展节点中离终点估价最小的节点的路径，
+     * 估价相同时取离起点更近的
+     */
+    AStar::StepResult FinishPartial(std::vector<Vec2> *outPaths)
+    {
+        const Params &param = *param_;
+        if ((param.maxExpansions == 0 && param.maxRadius == 0) || closest_ == nullptr)
+        {
+            Finish();
+            return AStar::STEP_FAILED;
+        }
+
+        BuildPath(closest_, outPaths);
+        if (param.smooth)
+        {
+            SmoothPath(param.start, outPaths);
+        }
+        Finish();
+        return AStar::STEP_PARTIAL;
+    }
+
+    // 与起点的横向和纵向距离都不超过 maxRadius
+    static bool IsInRadius(const Vec2 &pos, const Params &param)
+    {
+        return abs(pos.x - param.start.x) <= param.maxRadius && abs(pos.y - param.start.y) <= param.maxRadius;
+    }
+
+    /**
+     * 双向搜索：每次扩展开启列表较小的一侧，
+     * 一侧的节点已被另一侧访问过时用两侧g值之和更新最短路径长度 bestCost_。
+     * 两侧使用平衡的估价 (h(终点) - h(起点) + h(起点,终点)) / 2 和 (h(起点) - h(终点) + h(起点,终点)) / 2，
+     * 两者之和是常数 h(起点,终点)，两侧开启列表最小f值之和不小于 bestCost_ + h(起点,终点) 时，
+     * 不会再有更短的路径（估价函数一致时）
+     */
+    AStar::StepResult StepBidirectional(size_t maxExpansions, std::vector<Vec2> *outPaths)
+    {
+        const Params &param = *param_;
+        Node *nearbyNodes[JumpTable::DIR_COUNT];
+        for (size_t expansions = 0; expansions < maxExpansions; ++expansions)
+        {
+            if (space_.IsOpenListEmpty() || backSpace_->IsOpenListEmpty()
+                || (int)(space_.TopOpenList()->f + backSpace_->TopOpenList()->f) >= bestCost_ + totalHValue_)
+            {
+                if (bestCost_ == kNoPath)
+                {
+                    Finish();
+                    return AStar::STEP_FAILED;
+                }
+
+                BuildBidirectionalPath(outPaths);
+                if (param.smooth)
+                {
+                    SmoothPath(param.start, outPaths);
+                }
+                Finish();
+                return AStar::STEP_FOUND;
+            }
+
+            const bool forward = space_.GetOpenListSize() <= backSpace_->GetOpenListSize();
+            SearchSpace &space = forward ? space_ : *backSpace_;
+            SearchSpace &other = forward ? *backSpace_ : space_;
+
+            Node *current = space.PopOpenList();
+            ++expandedCount_;
+            current->state = SearchSpace::IN_CLOSELIST;
+
+            int count = FindCanPassNearbyNodes(space, current->pos, nearbyNodes);
+            if (!forward)
+            {
+                count += FindBlockedStart(current->pos, param.start, nearbyNodes + count);
+            }
+
+            for (int index = 0; index < count; ++index)
+            {
+                Node *nextNode = nearbyNodes[index];
+                if (nextNode->state == SearchSpace::IN_OPENLIST)
+                {
+                    HandleFoundInOpenList(space, current, nextNode);
+                }
+                else
+                {
+                    HandleNotFoundInOpenList(space, current, nextNode, CalcBalancedHValue(nextNode->pos, forward));
+                }
+
+                // 两侧在这个节点相遇
+                Node *otherNode = other.GetNode(nextNode->pos);
+                if (otherNode->state != SearchSpace::UNKNOWN && (int)(nextNode->g + otherNode->g) < bestCost_)
+                {
+                    bestCost_ = (int)(nextNode->g + otherNode->g);
+                    meetPos_ = nextNode->pos;
+                }
+            }
+        }
+
+        return AStar::STEP_PENDING;
+    }
+
+    // 起点与终点（多个终点时任意一个）是否连通
+    bool IsGoalConnected(const Params &param) const
+    {
+        if (param.goals == nullptr)
+        {
+            return param.regionIndex->IsConnected(param.start, param.end);
+        }
+
+        for (const Vec2 &goal : *param.goals)
+        {
+            if (param.regionIndex->IsConnected(param.start, goal))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool IsGoal(const Vec2 &pos) const
+    {
+        if (param_->goals == nullptr)
+        {
+            return pos == param_->end;
+        }
+        return std::binary_search(goalCells_.begin(), goalCells_.end(), (uint32_t)pos.y * param_->width + pos.x);
+    }
+
+    // 多个终点时取到各个终点估价的最小值，不会高估到最近终点的距离
+    uint32_t CalcGoalHValue(const Vec2 &current) const
+    {
+        if (param_->goals == nullptr)
+        {
+            return CalcHValue(current, param_->end);
+        }
+
+        uint32_t h = UINT32_MAX;
+        for (const Vec2 &goal : *param_->goals)
+        {
+            const uint32_t goalH = CalcHValue(current, goal);
+            if (goalH < h)
+            {
+                h = goalH;
+            }
+        }
+        return h;
+    }
+
+    uint32_t CalcBalancedHValue(const Vec2 &current, bool forward) const
+    {
+        const Params &param = *param_;
+        const int toEnd = (int)CalcHValue(current, param.end);
+        const int toStart = (int)CalcHValue(current, param.start);
+        return (uint32_t)(((forward ? toEnd - toStart : toStart - toEnd) + totalHValue_) / 2);
+    }
+
+    // 起点本身可以不可通过（单位站在上面），反向搜索时要单独把它作为可到达的相邻格子
+    int FindBlockedStart(const Vec2 &current, const Vec2 &start, Node **outList)
+    {
+        const int dx = start.x - current.x;
+        const int dy = start.y - current.y;
+        if (dx < -1 || dx > 1 || dy < -1 || dy > 1 || canPass_(start.x, start.y))
+        {
+            return 0;
+        }
+
+        if (dx != 0 && dy != 0
+            && (!MovePolicy::kCorner || !canPass_(current.x + dx, current.y) || !canPass_(current.x, current.y + dy)))
+        {
+            return 0;
+        }
+
+        Node *node = backSpace_->GetNode(start);
+        if (node->state == SearchSpace::IN_CLOSELIST)
+        {
+            return 0;
+        }
+        outList[0] = node;
+        return 1;
+    }
+
+    // 起点到相遇点取正向搜索的父节点，相遇点到终点取反向搜索的父节点
+    void BuildBidirectionalPath(std::vector<Vec2> *outPaths)
+    {
+        BuildPath(space_.GetNode(meetPos_), outPaths);
+        for (Node *node = backSpace_->GetNode(meetPos_)->parent; node; node = node->parent)
+        {
+            outPaths->push_back(node->pos);
+        }
+    }
+
+    // 最低位的 1 所在的位置
+    static int __LowestBit(uint32_t v)
+    {
+        int bit = 0;
+        while ((v & 1) == 0)
+        {
+            v >>= 1;
+            ++bit;
+        }
+        return bit;
+    }
+
+    static int __Sign(int v)
+    {
+        return (v > 0) - (v < 0);
+    }
+
+    uint32_t CalcGValue(Node *parent, const Vec2 &current) const
+    {
+        // 相邻格子或两个跳点之间只会是直线或斜线
+        const int dx = abs(current.x - parent->pos.x);
+        const int dy = abs(current.y - parent->pos.y);
+        const int oblique = dx < dy ? dx : dy;
+        if (!CanPass::kWeighted)
+        {
+            return parent->g + (uint32_t)(oblique * obliqueVal_ + (dx + dy - 2 * oblique) * stepVal_);
+        }
+
+        // 有格子代价时只在相邻格子之间移动，按两格代价的平均值计算
+        // 不可通过的起点取另一格的代价，反向搜索时起点是 current
+        int from = canPass_.GetCost(parent->pos.x, parent->pos.y);
+        int to = canPass_.GetCost(current.x, current.y);
+        if (from == CostGrid::kBlocked)
+        {
+            from = to;
+        }
+        else if (to == CostGrid::kBlocked)
+        {
+            to = from;
+        }
+        const int val = oblique > 0 ? obliqueVal_ : stepVal_;
+        return parent->g + (uint32_t)((from + to) * val / (2 * CostGrid::kDefaultCost));
+    }
+
+    // 设置了地标距离表时取两者中较大的估价
+    uint32_t CalcHValue(const Vec2 &current, const Vec2 &end) const
+    {
+        const uint32_t h = Heuristic::Calc(current, end, hStepVal_, hObliqueVal_);
+        if (param_->landmarks == nullptr)
+        {
+            return h;
+        }
+
+        const uint32_t landmarkH = param_->landmarks->Calc(current, end);
+        return landmarkH > h ? landmarkH : h;
+    }
+
+    // 一次读出 3x3 邻域，用位运算得到可走的相邻格子
+    int FindCanPassNearbyNodes(SearchSpace &space, const Vec2 &current, Node **outList)
+    {
+        uint32_t moves = MovePolicy::GetMoves(canPass_.GetNeighborhood(current.x, current.y, MovePolicy::kNeighborMask));
+        int count = 0;
+        while (moves != 0)
+        {
+            const int bit = __LowestBit(moves);
+            moves &= moves - 1;
+
+            Node *node = space.GetNode(Vec2(current.x + bit % 3 - 1, current.y + bit / 3 - 1));
+            if (node->state != SearchSpace::IN_CLOSELIST)
+            {
+                outList[count++] = node;
+            }
+        }
+        return count;
+    }
+
+    // 按父节点的前进方向裁剪邻居，再沿每个方向跳跃寻找跳点
+    int FindJumpPoints(Node *current, const Params &param, Node **outList)
+    {
+        int dirX[JumpTable::DIR_COUNT];
+        int dirY[JumpTable::DIR_COUNT];
+        int dirCount = 0;
+        auto addDir = [&](int dx, int dy) {
+            dirX[dirCount] = dx;
+            dirY[dirCount] = dy;
+            ++dirCount;
+        };
+
+        const Vec2 &pos = current->pos;
+        if (current->parent == nullptr)
+        {
+            const int count = MovePolicy::kCorner ? JumpTable::DIR_COUNT : JumpTable::DIR_RIGHT_DOWN;
+            for (int dir = 0; dir < count; ++dir)
+            {
+                addDir(JumpTable::kDirX[dir], JumpTable::kDirY[dir]);
+            }
+        }
+        else
+        {
+            const Vec2 &from = current->parent->pos;
+            const int dx = __Sign(pos.x - from.x);
+            const int dy = __Sign(pos.y - from.y);
+            if (dx != 0 && dy != 0)
+            {
+                addDir(dx, 0);
+                addDir(0, dy);
+                addDir(dx, dy);
+            }
+            else if (dx != 0)
+            {
+                addDir(dx, 0);
+                addDir(0, 1);
+                addDir(0, -1);
+                if (MovePolicy::kCorner)
+                {
+                    addDir(dx, 1);
+                    addDir(dx, -1);
+                }
+            }
+            else
+            {
+                addDir(0, dy);
+                addDir(1, 0);
+                addDir(-1, 0);
+                if (MovePolicy::kCorner)
+                {
+                    addDir(1, dy);
+                    addDir(-1, dy);
+                }
+            }
+        }
+
+        int count = 0;
+        Vec2 jumpPoint;
+        for (int i = 0; i < dirCount; ++i)
+        {
+            const bool found = param.mode == AStar::SEARCH_JPS_PLUS
+                ? JumpByTable(pos, dirX[i], dirY[i], param, &jumpPoint)
+                : Jump(pos, dirX[i], dirY[i], param.end, &jumpPoint);
+            if (found)
+            {
+                Node *node = space_.GetNode(jumpPoint);
+                if (node->state != SearchSpace::IN_CLOSELIST)
+                {
+                    outList[count++] = node;
+                }
+            }
+        }
+        return count;
+    }
+
+    // 从 current 沿(dx,dy)方向跳跃，找到跳点或终点返回 true
+    bool Jump(const Vec2 &current, int dx, int dy, const Vec2 &end, Vec2 *outPos) const
+    {
+        int x = current.x;
+        int y = current.y;
+        while (JumpTable::CanStep(canPass_, x, y, dx, dy))
+        {
+            x += dx;
+            y += dy;
+
+            bool jumpPoint = (x == end.x && y == end.y);
+            if (!jumpPoint)
+            {
+                if (dx != 0 && dy != 0)
+                {
+                    jumpPoint = JumpStraight(x, y, dx, 0, end) || JumpStraight(x, y, 0, dy, end);
+                }
+                else
+                {
+                    jumpPoint = JumpTable::IsForced(canPass_, x, y, dx, dy);
+                    if (!jumpPoint && !MovePolicy::kCorner && dy != 0)
+                    {
+                        // 4方向时竖直前进还要检查水平方向上的跳点
+                        jumpPoint = JumpStraight(x, y, 1, 0, end) || JumpStraight(x, y, -1, 0, end);
+                    }
+                }
+            }
+
+            if (jumpPoint)
+            {
+                outPos->Reset(x, y);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 沿正交方向跳跃，只判断是否存在跳点或终点
+    bool JumpStraight(int x, int y, int dx, int dy, const Vec2 &end) const
+    {
+        while (canPass_(x + dx, y + dy))
+        {
+            x += dx;
+            y += dy;
+            if ((x == end.x && y == end.y) || JumpTable::IsForced(canPass_, x, y, dx, dy))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // JPS+：直接查表得到跳跃距离，终点在可前进范围内时直接跳到终点所在的行列
+    bool JumpByTable(const Vec2 &current, int dx, int dy, const Params &param, Vec2 *outPos) const
+    {
+        const int dist = param.jumpTable->Get(current, JumpTable::GetDirection(dx, dy));
+        const int range = dist > 0 ? dist : -dist;
+        const int ex = param.end.x - current.x;
+        const int ey = param.end.y - current.y;
+
+        int steps = 0;
+        if (dx != 0 && dy != 0)
+        {
+            // 终点在该斜角方向的象限内，停在与终点同行或同列的格子上
+            if (__Sign(ex) == dx && __Sign(ey) == dy)
+            {
+                const int diag = abs(ex) < abs(ey) ? abs(ex) : abs(ey);
+                if (diag <= range)
+                {
+                    steps = diag;
+                }
+            }
+        }
+        else if (dx != 0)
+        {
+            if (ey == 0 && __Sign(ex) == dx && abs(ex) <= range)
+            {
+                steps = abs(ex);
+            }
+        }
+        else if (__Sign(ey) == dy && abs(ey) <= range)
+        {
+            // 4方向时竖直前进停在终点所在行上，再由水平方向到达终点
+            if (ex == 0 || !MovePolicy::kCorner)
+            {
+                steps = abs(ey);
+            }
+        }
+
+        if (steps == 0 && dist > 0)
+        {
+            steps = dist;
+        }
+
+        if (steps == 0)
+        {
+            return false;
+        }
+
+        outPos->Reset(current.x + dx * steps, current.y + dy * steps);
+        return true;
+    }
+
+    void HandleFoundInOpenList(SearchSpace &space, Node *current, Node *destination)
+    {
+        const uint32_t g = CalcGValue(current, destination->pos);
+        if (g < destination->g)
+        {
+            destination->g = g;
+            destination->f = destination->g + destination->h;
+            destination->parent = current;
+            space.UpdateOpenList(destination);
+        }
+    }
+
+    void HandleNotFoundInOpenList(SearchSpace &space, Node *current, Node *destination, uint32_t h)
+    {
+        destination->parent = current;
+        destination->g = CalcGValue(current, destination->pos);
+        destination->h = h;
+        destination->f = destination->g + destination->h;
+        space.PushOpenList(destination);
+    }
+
+    // 从终点回溯到起点，跳点之间是直线或斜线，逐格补全
+    void BuildPath(Node *current, std::vector<Vec2> *outPaths) const
+    {
+        while (current->parent)
+        {
+            Vec2 pos = current->pos;
+            const Vec2 &to = current->parent->pos;
+            while (!(pos == to))
+            {
+                outPaths->push_back(pos);
+                pos.x += __Sign(to.x - pos.x);
+                pos.y += __Sign(to.y - pos.y);
+            }
+            current = current->parent;
+        }
+        std::reverse(outPaths->begin(), outPaths->end());
+    }
+
+    // 拉绳：从当前拐点出发，保留视线被挡住之前的最后一个格子作为下一个拐点
+    // 视线不考虑格子代价，所以 Params::IsValid 不允许 smooth 与 costGrid 同时使用
+    void SmoothPath(const Vec2 &start, std::vector<Vec2> *paths) const
+    {
+        std::vector<Vec2> &cells = *paths;
+        const size_t count = cells.size();
+        size_t kept = 0;
+        Vec2 anchor = start;
+        for (size_t i = 0; i + 1 < count; ++i)
+        {
+            if (!HasLineOfSight(anchor, cells[i + 1]))
+            {
+                anchor = cells[i];
+                cells[kept++] = anchor;
+            }
+        }
+        if (count > 0)
+        {
+            cells[kept++] = cells[count - 1];
+        }
+        cells.resize(kept);
+    }
+
+    // 两个格子中心的连线经过的格子（不含 from）是否都可通过
+    // 连线恰好穿过格点时要求两侧格子都可通过，与不能穿过拐角的规则一致；4方向时只允许水平或竖直的连线
+    bool HasLineOfSight(const Vec2 &from, const Vec2 &to) const
+    {
+        const int dx = abs(to.x - from.x);
+        const int dy = abs(to.y - from.y);
+        if (!MovePolicy::kCorner && dx != 0 && dy != 0)
+        {
+            return false;
+        }
+
+        const int sx = __Sign(to.x - from.x);
+        const int sy = __Sign(to.y - from.y);
+        int x = from.x;
+        int y = from.y;
+        int error = dx - dy;
+        for (int n = dx + dy; n > 0; --n)
+        {
+            if (error > 0)
+            {
+                x += sx;
+                error -= dy * 2;
+            }
+            else if (error < 0)
+            {
+                y += sy;
+                error += dx * 2;
+            }
+            else
+            {
+                if (!canPass_(x + sx, y) || !canPass_(x, y + sy))
+                {
+                    return false;
+                }
+                x += sx;
+                y += sy;
+                error += (dx - dy) * 2;
+                --n;
+            }
+
+            if (!canPass_(x, y))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    int stepVal_; // 到相邻正交格子的g值
+    int obliqueVal_; // 到相邻斜角格子的g值
+    int hStepVal_; // 估价使用的正交代价，按地图上最小的格子代价缩放
+    int hObliqueVal_; // 估价使用的斜角代价
+
+    SearchSpace &space_;
+    SearchSpace *backSpace_;
+    const CanPass &canPass_;
+    const Params *param_; // 进行中的搜索参数，搜索结束后为 nullptr
+    size_t expandedCount_;
+    Node *closest_; // 已扩展节点中离终点估价最小的节点，搜索受限时返回到它的路径
+    int bestCost_; // 双向搜索目前找到的最短路径长度
+    int totalHValue_; // 双向搜索起点到终点的估价
+    Vec2 meetPos_; // bestCost_ 对应的相遇点
+    std::vector<uint32_t> goalCells_; // 多个终点所在格子的下标，已排序
+};
@@ -0,0 +1,53 @@
+﻿#include <assert.h>
+#include "astar/bitgrid.h"
+
+BitGrid::BitGrid() :
+    width_(0),
+    height_(0),
+    stride_(0)
+{
+}
+
+BitGrid::~BitGrid()
+{
+}
+
+void BitGrid::Reset(uint16_t width, uint16_t height)
+{
+    width_ = width;
+    height_ = height;
+    stride_ = ((size_t)width_ + 2 + 63) / 64;
+    words_.clear();
+    words_.resize(stride_ * ((size_t)height_ + 2), 0);
+}
+
+void BitGrid::Build(uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass)
+{
+    Reset(width, height);
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
+        {
+            if (canPass(AStar::Vec2(x, y)))
+            {
+                Set(x, y, true);
+            }
+        }
+    }
+}
+
+void BitGrid::Set(int x, int y, bool passable)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+
+    const size_t bit = (size_t)(y + 1) * stride_ * 64 + x + 1;
+    const uint64_t mask = (uint64_t)1 << (bit & 63);
+    if (passable)
+    {
+        words_[bit >> 6] |= mask;
+    }
+    else
+    {
+        words_[bit >> 6] &= ~mask;
+    }
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 按位存储的可通过性网格，每个格子占 1 bit，4096x4096 的地图只需 2MB
+*
+* 每行按 64 位字对齐，四周各留一圈不可通过的格子作为哨兵，
+* 读取一个格子的 3x3 邻域只需要每行一到两次字读取和移位，不需要边界判断。
+*/
+
+class BitGrid final
+{
+public:
+    BitGrid();
+    ~BitGrid();
+
+    /**
+     * 重置为 width*height 的网格，所有格子不可通过
+     */
+    void Reset(uint16_t width, uint16_t height);
+
+    /**
+     * 根据 canPass 生成网格
+     */
+    void Build(uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass);
+
+    uint16_t GetWidth() const { return width_; }
+    uint16_t GetHeight() const { return height_; }
+
+    bool Get(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+        {
+            return false;
+        }
+        const size_t bit = (size_t)(y + 1) * stride_ * 64 + x + 1;
+        return ((words_[bit >> 6] >> (bit & 63)) & 1) != 0;
+    }
+
+    void Set(int x, int y, bool passable);
+
+    /**
+     * 读取(x,y)的 3x3 邻域，第 (dy+1)*3+(dx+1) 位表示(x+dx,y+dy)是否可通过
+     * 地图外的格子视为不可通过
+     */
+    uint32_t GetNeighborhood(int x, int y) const
+    {
+        // 哨兵偏移了一行一列，所以(x-1,y-1)对应的位置正好是(x,y)
+        return Read3(y, x) | (Read3(y + 1, x) << 3) | (Read3(y + 2, x) << 6);
+    }
+
+private:
+    uint32_t Read3(int row, int col) const
+    {
+        const uint64_t *p = &words_[(size_t)row * stride_ + (col >> 6)];
+        const unsigned shift = col & 63;
+        uint64_t bits = p[0] >> shift;
+        if (shift > 61)
+        {
+            bits |= p[1] << (64 - shift);
+        }
+        return (uint32_t)(bits & 7);
+    }
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    size_t stride_; // 每行（含哨兵）占用的 64 位字数
+    std::vector<uint64_t> words_;
+};
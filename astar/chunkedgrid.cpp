@@ -0,0 +1,287 @@
+﻿#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <memory>
+#include "astar/chunkedgrid.h"
+
+const int ChunkedGrid::kChunkShift;
+const int ChunkedGrid::kChunkSize;
+const int ChunkedGrid::kChunkMask;
+const uint32_t ChunkedGrid::kNone;
+
+static const char kFileMagic[4] = { 'V', 'T', 'W', 'C' };
+static const uint32_t kFileVersion = 1;
+static const long kHeaderSize = sizeof(kFileMagic) + sizeof(uint32_t) + sizeof(uint16_t) * 2;
+
+ChunkedGrid::ChunkedGrid() :
+    width_(0),
+    height_(0),
+    chunksPerRow_(0),
+    maxChunks_(0),
+    head_(kNone),
+    tail_(kNone),
+    loadedCount_(0),
+    loadCount_(0),
+    lastIndex_(kNone),
+    lastRows_(nullptr)
+{
+}
+
+ChunkedGrid::~ChunkedGrid()
+{
+}
+
+void ChunkedGrid::Reset(uint16_t width, uint16_t height, size_t maxChunks, const LoadFunc &load)
+{
+    assert(maxChunks > 0 && load != nullptr);
+
+    width_ = width;
+    height_ = height;
+    chunksPerRow_ = ((uint32_t)width_ + kChunkMask) >> kChunkShift;
+    maxChunks_ = maxChunks;
+    load_ = load;
+
+    const size_t chunkRows = ((size_t)height_ + kChunkMask) >> kChunkShift;
+    chunks_.clear();
+    slots_.assign(chunksPerRow_ * chunkRows, kNone);
+    head_ = kNone;
+    tail_ = kNone;
+    loadedCount_ = 0;
+    loadCount_ = 0;
+    lastIndex_ = kNone;
+    lastRows_ = nullptr;
+}
+
+bool ChunkedGrid::Open(const std::string &filename, size_t maxChunks)
+{
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t version = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    bool ok = fread(magic, sizeof(magic), 1, file) == 1
+        && fread(&version, sizeof(version), 1, file) == 1
+        && fread(&width, sizeof(width), 1, file) == 1
+        && fread(&height, sizeof(height), 1, file) == 1
+        && memcmp(magic, kFileMagic, sizeof(magic)) == 0
+        && version == kFileVersion;
+
+    // 文件应恰好包含所有块
+    const long chunkBytes = sizeof(uint64_t) * kChunkSize;
+    const long chunksPerRow = ((long)width + kChunkMask) >> kChunkShift;
+    const long chunkRows = ((long)height + kChunkMask) >> kChunkShift;
+    ok = ok && fseek(file, 0, SEEK_END) == 0 && ftell(file) == kHeaderSize + chunksPerRow * chunkRows * chunkBytes;
+    if (!ok)
+    {
+        fclose(file);
+        return false;
+    }
+
+    std::shared_ptr<FILE> shared(file, fclose);
+    Reset(width, height, maxChunks, [shared, chunksPerRow, chunkBytes](uint16_t chunkX, uint16_t chunkY, uint64_t *rows) {
+        const long offset = kHeaderSize + ((long)chunkY * chunksPerRow + chunkX) * chunkBytes;
+        return fseek(shared.get(), offset, SEEK_SET) == 0
+            && fread(rows, sizeof(uint64_t), kChunkSize, shared.get()) == (size_t)kChunkSize;
+    });
+    return true;
+}
+
+bool ChunkedGrid::Save(const std::string &filename, uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool ok = fwrite(kFileMagic, sizeof(kFileMagic), 1, file) == 1
+        && fwrite(&kFileVersion, sizeof(kFileVersion), 1, file) == 1
+        && fwrite(&width, sizeof(width), 1, file) == 1
+        && fwrite(&height, sizeof(height), 1, file) == 1;
+
+    // 按块的顺序写入，每块内每行一个 64 位字
+    uint64_t rows[kChunkSize];
+    for (int originY = 0; ok && originY < height; originY += kChunkSize)
+    {
+        for (int originX = 0; ok && originX < width; originX += kChunkSize)
+        {
+            memset(rows, 0, sizeof(rows));
+            for (int y = originY; y < originY + kChunkSize && y < height; ++y)
+            {
+                for (int x = originX; x < originX + kChunkSize && x < width; ++x)
+                {
+                    if (canPass(AStar::Vec2((uint16_t)x, (uint16_t)y)))
+                    {
+                        rows[y - originY] |= (uint64_t)1 << (x - originX);
+                    }
+                }
+            }
+            ok = fwrite(rows, sizeof(uint64_t), kChunkSize, file) == (size_t)kChunkSize;
+        }
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+uint32_t ChunkedGrid::GetNeighborhoodAcross(int x, int y) const
+{
+    uint32_t cells = 0;
+    for (int bit = 0; bit < 9; ++bit)
+    {
+        if (Get(x + bit % 3 - 1, y + bit / 3 - 1))
+        {
+            cells |= 1u << bit;
+        }
+    }
+    return cells;
+}
+
+// 查找或加载一块，并移到最近访问链表的表头
+const uint64_t* ChunkedGrid::Touch(uint32_t index) const
+{
+    uint32_t slot = slots_[index];
+    if (slot != kNone)
+    {
+        Unlink(slot);
+    }
+    else
+    {
+        // 还有空位时新建，否则复用表尾最久未访问（或已卸载）的块
+        if (chunks_.size() < maxChunks_)
+        {
+            slot = (uint32_t)chunks_.size();
+            chunks_.emplace_back();
+        }
+        else
+        {
+            slot = tail_;
+            Unlink(slot);
+            if (chunks_[slot].index != kNone)
+            {
+                slots_[chunks_[slot].index] = kNone;
+                --loadedCount_;
+            }
+        }
+
+        Chunk &chunk = chunks_[slot];
+        memset(chunk.rows, 0, sizeof(chunk.rows));
+        const uint16_t chunkX = (uint16_t)(index % chunksPerRow_);
+        const uint16_t chunkY = (uint16_t)(index / chunksPerRow_);
+        if (!load_(chunkX, chunkY, chunk.rows))
+        {
+            memset(chunk.rows, 0, sizeof(chunk.rows));
+        }
+
+        // 超出地图的部分视为不可通过，邻域读取不需要再判断边界
+        const int validWidth = width_ - chunkX * kChunkSize;
+        const int validHeight = height_ - chunkY * kChunkSize;
+        const uint64_t mask = validWidth >= kChunkSize ? ~(uint64_t)0 : (((uint64_t)1 << validWidth) - 1);
+        for (int y = 0; y < kChunkSize; ++y)
+        {
+            chunk.rows[y] = y < validHeight ? (chunk.rows[y] & mask) : 0;
+        }
+
+        chunk.index = index;
+        slots_[index] = slot;
+        ++loadedCount_;
+        ++loadCount_;
+    }
+
+    PushFront(slot);
+    lastIndex_ = index;
+    lastRows_ = chunks_[slot].rows;
+    return lastRows_;
+}
+
+void ChunkedGrid::Unlink(uint32_t slot) const
+{
+    Chunk &chunk = chunks_[slot];
+    if (chunk.prev != kNone)
+    {
+        chunks_[chunk.prev].next = chunk.next;
+    }
+    else
+    {
+        head_ = chunk.next;
+    }
+
+    if (chunk.next != kNone)
+    {
+        chunks_[chunk.next].prev = chunk.prev;
+    }
+    else
+    {
+        tail_ = chunk.prev;
+    }
+}
+
+void ChunkedGrid::PushFront(uint32_t slot) const
+{
+    Chunk &chunk = chunks_[slot];
+    chunk.prev = kNone;
+    chunk.next = head_;
+    if (head_ != kNone)
+    {
+        chunks_[head_].prev = slot;
+    }
+    else
+    {
+        tail_ = slot;
+    }
+    head_ = slot;
+}
+
+void ChunkedGrid::Unload(uint16_t chunkX, uint16_t chunkY)
+{
+    const uint32_t index = (uint32_t)chunkY * chunksPerRow_ + chunkX;
+    if (index >= slots_.size() || slots_[index] == kNone)
+    {
+        return;
+    }
+
+    // 空出的块移到表尾，下次加载时优先复用
+    const uint32_t slot = slots_[index];
+    Unlink(slot);
+    Chunk &chunk = chunks_[slot];
+    chunk.index = kNone;
+    chunk.next = kNone;
+    chunk.prev = tail_;
+    if (tail_ != kNone)
+    {
+        chunks_[tail_].next = slot;
+    }
+    else
+    {
+        head_ = slot;
+    }
+    tail_ = slot;
+
+    slots_[index] = kNone;
+    --loadedCount_;
+    if (lastIndex_ == index)
+    {
+        lastIndex_ = kNone;
+        lastRows_ = nullptr;
+    }
+}
+
+void ChunkedGrid::UnloadAll()
+{
+    slots_.assign(slots_.size(), kNone);
+    chunks_.clear();
+    head_ = kNone;
+    tail_ = kNone;
+    loadedCount_ = 0;
+    lastIndex_ = kNone;
+    lastRows_ = nullptr;
+}
+
+size_t ChunkedGrid::GetMemoryUsage() const
+{
+    return chunks_.capacity() * sizeof(Chunk) + slots_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 分块加载的可通过性网格，用于无法整张放进内存的超大地图
+*
+* Vec2 允许 65535x65535 的地图，即使按位存储也要 512MB。
+* ChunkedGrid 把地图切成 64x64 的块，每块 512 字节（块内每行一个 64 位字），
+* 第一次读取某块时才调用 LoadFunc 读入，数据可以来自磁盘文件、内存映射文件或程序生成。
+* 常驻的块数达到 maxChunks 后淘汰最久未访问的块，再次访问时重新加载，
+* 占用的内存不随地图大小增长。
+*
+* 设置到 AStar::Params::chunkGrid 后寻路跨块透明进行，节点数组自动按页分配（AStar::LAYOUT_PAGED），
+* 只有搜索到的区域占用内存。maxChunks 应大于单次搜索覆盖的块数，否则同一块会被反复加载。
+*
+* 读取时可能加载或淘汰块，const 接口也会修改内部状态，不能在多个线程中同时调用，
+* PathBatch 和 PathService 会拒绝设置了 chunkGrid 的参数。
+* 地图变化时先修改数据源，再调用 Unload 让对应的块在下次访问时重新加载。
+*
+* Save 把整张地图按块写入文件，Open 打开该文件并按需随机读取其中的块。
+*/
+
+class ChunkedGrid final
+{
+public:
+    static const int kChunkShift = 6;
+    static const int kChunkSize = 1 << kChunkShift; // 块的边长
+
+    /**
+     * 读入第 (chunkX, chunkY) 块，rows[y] 的第 x 位表示块内(x,y)是否可通过
+     * rows 已清零，超出地图的部分不会被读取；返回 false 时整块视为不可通过
+     */
+    using LoadFunc = std::function<bool(uint16_t chunkX, uint16_t chunkY, uint64_t *rows)>;
+
+public:
+    ChunkedGrid();
+    ~ChunkedGrid();
+
+    /**
+     * 重置为 width*height 的地图，卸载所有块
+     */
+    void Reset(uint16_t width, uint16_t height, size_t maxChunks, const LoadFunc &load);
+
+    /**
+     * 打开 Save 写入的文件，之后按需从文件读取块
+     */
+    bool Open(const std::string &filename, size_t maxChunks);
+
+    /**
+     * 按块把 canPass 描述的地图写入文件
+     */
+    static bool Save(const std::string &filename, uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass);
+
+    uint16_t GetWidth() const { return width_; }
+    uint16_t GetHeight() const { return height_; }
+
+    bool Get(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+        {
+            return false;
+        }
+        const uint64_t *rows = GetRows(x >> kChunkShift, y >> kChunkShift);
+        return ((rows[y & kChunkMask] >> (x & kChunkMask)) & 1) != 0;
+    }
+
+    /**
+     * 读取(x,y)的 3x3 邻域，第 (dy+1)*3+(dx+1) 位表示(x+dx,y+dy)是否可通过
+     * 邻域在块内时只查找一次块
+     */
+    uint32_t GetNeighborhood(int x, int y) const
+    {
+        const int localX = x & kChunkMask;
+        const int localY = y & kChunkMask;
+        if (localX == 0 || localX == kChunkMask || localY == 0 || localY == kChunkMask)
+        {
+            return GetNeighborhoodAcross(x, y);
+        }
+
+        const uint64_t *rows = GetRows(x >> kChunkShift, y >> kChunkShift);
+        const int shift = localX - 1;
+        return (uint32_t)((rows[localY - 1] >> shift) & 7)
+            | (uint32_t)(((rows[localY] >> shift) & 7) << 3)
+            | (uint32_t)(((rows[localY + 1] >> shift) & 7) << 6);
+    }
+
+    /**
+     * 卸载一块，下次访问时重新加载
+     */
+    void Unload(uint16_t chunkX, uint16_t chunkY);
+    void UnloadAll();
+
+    size_t GetMaxChunks() const { return maxChunks_; }
+    size_t GetLoadedCount() const { return loadedCount_; }
+
+    /**
+     * 累计加载的次数，远大于访问过的块数时说明 maxChunks 太小
+     */
+    uint64_t GetLoadCount() const { return loadCount_; }
+
+    /**
+     * 常驻块和块索引占用的内存（字节）
+     */
+    size_t GetMemoryUsage() const;
+
+private:
+    static const int kChunkMask = kChunkSize - 1;
+    static const uint32_t kNone = UINT32_MAX;
+
+    struct Chunk
+    {
+        uint64_t rows[kChunkSize];
+        uint32_t index; // 块在地图中的序号，kNone 表示空闲
+        uint32_t prev; // 最近访问链表，表头是最近访问的块
+        uint32_t next;
+    };
+
+    const uint64_t* GetRows(int chunkX, int chunkY) const
+    {
+        const uint32_t index = (uint32_t)chunkY * chunksPerRow_ + chunkX;
+        return index == lastIndex_ ? lastRows_ : Touch(index);
+    }
+
+    uint32_t GetNeighborhoodAcross(int x, int y) const;
+    const uint64_t* Touch(uint32_t index) const;
+    void Unlink(uint32_t slot) const;
+    void PushFront(uint32_t slot) const;
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    uint32_t chunksPerRow_;
+    size_t maxChunks_;
+    LoadFunc load_;
+
+    // 以下成员在读取时更新
+    mutable std::vector<Chunk> chunks_; // 常驻的块，按需增长到 maxChunks_
+    mutable std::vector<uint32_t> slots_; // 每块所在的 chunks_ 下标，kNone 表示未加载
+    mutable uint32_t head_;
+    mutable uint32_t tail_;
+    mutable size_t loadedCount_;
+    mutable uint64_t loadCount_;
+    mutable uint32_t lastIndex_; // 最近一次访问的块，连续访问同一块时不查表
+    mutable const uint64_t *lastRows_;
+};
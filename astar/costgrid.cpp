@@ -0,0 +1,71 @@
+﻿#include <assert.h>
+#include "astar/costgrid.h"
+
+const uint8_t CostGrid::kBlocked;
+const uint8_t CostGrid::kDefaultCost;
+
+CostGrid::CostGrid() :
+    width_(0),
+    height_(0),
+    minCost_(kDefaultCost)
+{
+}
+
+CostGrid::~CostGrid()
+{
+}
+
+void CostGrid::Reset(uint16_t width, uint16_t height)
+{
+    width_ = width;
+    height_ = height;
+    layout_.Reset(width_, height_, GridLayout::kTileShift);
+    costs_.assign(layout_.GetSize(), kBlocked);
+    costCounts_.assign(UINT8_MAX + 1, 0);
+    costCounts_[kBlocked] = (uint32_t)width_ * height_;
+    minCost_ = kDefaultCost;
+}
+
+void CostGrid::Build(uint16_t width, uint16_t height, const CostFunc &getCost)
+{
+    Reset(width, height);
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
+        {
+            const uint8_t cost = getCost(AStar::Vec2(x, y));
+            costs_[layout_.Index(x, y)] = cost;
+            --costCounts_[kBlocked];
+            ++costCounts_[cost];
+        }
+    }
+    UpdateMinCost();
+}
+
+void CostGrid::Set(int x, int y, uint8_t cost)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+
+    uint8_t &cell = costs_[layout_.Index(x, y)];
+    --costCounts_[cell];
+    ++costCounts_[cost];
+    const bool changeMin = (cost != kBlocked && cost < minCost_) || cell == minCost_;
+    cell = cost;
+    if (changeMin)
+    {
+        UpdateMinCost();
+    }
+}
+
+void CostGrid::UpdateMinCost()
+{
+    for (int cost = 1; cost <= UINT8_MAX; ++cost)
+    {
+        if (costCounts_[cost] > 0)
+        {
+            minCost_ = (uint8_t)cost;
+            return;
+        }
+    }
+    minCost_ = kDefaultCost;
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+#include <stdint.h>
+#include <functional>
+#include <vector>
+#include "astar/astar.h"
+#include "astar/gridlayout.h"
+
+/**
+* 地形代价网格，每个格子记录一个 0~255 的移动代价
+*
+* 0 表示不可通过；kDefaultCost 对应普通地面，与 AStar 的正交代价一致。
+* 道路可以设得比它小，沼泽设得比它大。
+* 相邻两格之间移动的代价是两格代价的平均值，正交移动乘以 1，斜角移动乘以 1.4，
+* 来回的代价相同，双向搜索也可以使用。
+*
+* 设置到 AStar::Params::costGrid 后同时决定可通过性，不再调用 canPass 或读取 passGrid。
+* 只能用于 SEARCH_ASTAR 和 SEARCH_BIDIRECTIONAL，不能与 landmarks、chunkGrid 或 smooth 同时使用
+* （地标距离和拉绳的视线都不考虑代价）。
+* 估价函数按地图上最小的代价缩放，保证不会高估；路径代价按 32 位累加，大地图上的长路径不会溢出。
+* 代价按 8x8 分块存储（GridLayout），读取 3x3 邻域时大多只访问一个缓存行。
+*/
+
+class CostGrid final
+{
+public:
+    static const uint8_t kBlocked = 0;
+    static const uint8_t kDefaultCost = 10;
+
+    using CostFunc = std::function<uint8_t(const AStar::Vec2&)>;
+
+public:
+    CostGrid();
+    ~CostGrid();
+
+    /**
+     * 重置为 width*height 的网格，所有格子不可通过
+     */
+    void Reset(uint16_t width, uint16_t height);
+
+    /**
+     * 根据 getCost 生成网格
+     */
+    void Build(uint16_t width, uint16_t height, const CostFunc &getCost);
+
+    uint16_t GetWidth() const { return width_; }
+    uint16_t GetHeight() const { return height_; }
+
+    /**
+     * 地图外的格子视为不可通过
+     */
+    uint8_t Get(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+        {
+            return kBlocked;
+        }
+        return costs_[layout_.Index(x, y)];
+    }
+
+    void Set(int x, int y, uint8_t cost);
+
+    /**
+     * 可通过格子中最小的代价，没有可通过的格子时返回 kDefaultCost
+     */
+    uint8_t GetMinCost() const { return minCost_; }
+
+    /**
+     * 读取(x,y)的 3x3 邻域，第 (dy+1)*3+(dx+1) 位表示(x+dx,y+dy)是否可通过
+     */
+    uint32_t GetNeighborhood(int x, int y, uint32_t mask) const
+    {
+        uint32_t cells = 0;
+        for (int bit = 0; bit < 9; ++bit)
+        {
+            if ((mask & (1u << bit)) && Get(x + bit % 3 - 1, y + bit / 3 - 1) != kBlocked)
+            {
+                cells |= 1u << bit;
+            }
+        }
+        return cells;
+    }
+
+private:
+    void UpdateMinCost();
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    uint8_t minCost_;
+    GridLayout layout_;
+    std::vector<uint8_t> costs_; // 按 layout_ 存放
+    std::vector<uint32_t> costCounts_; // 每种代价的格子数，用来维护 minCost_
+};
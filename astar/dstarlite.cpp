@@ -0,0 +1,413 @@
+﻿#include <assert.h>
+#include "astar/dstarlite.h"
+#include "astar/bitgrid.h"
+
+static const int kStepVal = 10;
+static const int kObliqueVal = 14;
+
+static const int kDirX[8] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+static const int kDirY[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+DStarLite::DStarLite() :
+    width_(0),
+    height_(0),
+    corner_(false),
+    km_(0),
+    passGrid_(nullptr),
+    expandedCount_(0)
+{
+}
+
+DStarLite::~DStarLite()
+{
+}
+
+bool DStarLite::Init(const AStar::Params &param)
+{
+    if (!param.IsValid() || param.width == 0 || param.height == 0
+        || param.start.x >= param.width || param.start.y >= param.height
+        || param.end.x >= param.width || param.end.y >= param.height)
+    {
+        assert(false);
+        return false;
+    }
+
+    if (param.passGrid && (param.passGrid->GetWidth() != param.width || param.passGrid->GetHeight() != param.height))
+    {
+        assert(false);
+        return false;
+    }
+
+    // 只使用静态的可通过性，不支持地形代价、占用层和分块加载的地图
+    if (param.costGrid || param.occupancy || param.chunkGrid)
+    {
+        assert(false);
+        return false;
+    }
+
+    width_ = param.width;
+    height_ = param.height;
+    corner_ = param.corner;
+    start_ = param.start;
+    end_ = param.end;
+    last_ = param.start;
+    km_ = 0;
+    canPass_ = param.canPass;
+    passGrid_ = param.passGrid;
+    expandedCount_ = 0;
+
+    Node init;
+    init.g = kInfinity;
+    init.rhs = kInfinity;
+    init.key1 = kInfinity;
+    init.key2 = kInfinity;
+    init.heapIndex = kInvalidIndex;
+    nodes_.assign((size_t)width_ * height_, init);
+    openList_.clear();
+
+    // 反向搜索，终点的 rhs 为 0
+    const uint32_t goal = GetIndex(end_.x, end_.y);
+    nodes_[goal].rhs = 0;
+    HeapPush(goal);
+    return true;
+}
+
+void DStarLite::UpdateCells(const std::vector<AStar::Vec2> &changedCells)
+{
+    // 格子变化会影响它自身以及经过它的所有边（含绕过拐角的斜边），
+    // 这些边的端点都在它的 3x3 邻域内
+    for (const auto &cell : changedCells)
+    {
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                const int x = cell.x + dx;
+                const int y = cell.y + dy;
+                if (x >= 0 && x < width_ && y >= 0 && y < height_)
+                {
+                    UpdateVertex(GetIndex(x, y));
+                }
+            }
+        }
+    }
+}
+
+void DStarLite::MoveStart(const AStar::Vec2 &start)
+{
+    assert(start.x < width_ && start.y < height_);
+    start_ = start;
+}
+
+std::vector<AStar::Vec2> DStarLite::Find()
+{
+    std::vector<AStar::Vec2> paths;
+    if (nodes_.empty())
+    {
+        return paths;
+    }
+
+    // 队列中的优先级是用旧起点算的，累加起点移动的距离作为修正
+    if (!(last_ == start_))
+    {
+        const int dx = abs(last_.x - start_.x);
+        const int dy = abs(last_.y - start_.y);
+        km_ += corner_
+            ? (dx < dy ? dx : dy) * kObliqueVal + abs(dx - dy) * kStepVal
+            : (dx + dy) * kStepVal;
+        last_ = start_;
+    }
+
+    ComputeShortestPath();
+
+    uint32_t current = GetIndex(start_.x, start_.y);
+    // 搜索停止时起点的 g 值可能尚未更新，rhs 才是起点到终点的距离
+    if (nodes_[current].rhs >= kInfinity)
+    {
+        return paths;
+    }
+
+    // 沿 g 值下降的方向走到终点
+    const uint32_t goal = GetIndex(end_.x, end_.y);
+    uint32_t neighbors[8];
+    int costs[8];
+    while (current != goal)
+    {
+        const int count = GetNeighbors(current, neighbors, costs);
+        uint32_t next = current;
+        int best = kInfinity;
+        for (int i = 0; i < count; ++i)
+        {
+            const int g = nodes_[neighbors[i]].g;
+            if (g < kInfinity && g + costs[i] < best)
+            {
+                best = g + costs[i];
+                next = neighbors[i];
+            }
+        }
+
+        if (next == current || paths.size() >= nodes_.size())
+        {
+            assert(false);
+            paths.clear();
+            break;
+        }
+
+        current = next;
+        paths.push_back(AStar::Vec2(current % width_, current / width_));
+    }
+
+    return paths;
+}
+
+bool DStarLite::CanPass(int x, int y) const
+{
+    if (passGrid_)
+    {
+        return passGrid_->Get(x, y);
+    }
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? canPass_(AStar::Vec2(x, y)) : false;
+}
+
+// 可通过的相邻格子及移动代价，两端都必须可通过
+int DStarLite::GetNeighbors(uint32_t index, uint32_t *outList, int *outCosts) const
+{
+    const int x = index % width_;
+    const int y = index / width_;
+    if (!CanPass(x, y))
+    {
+        return 0;
+    }
+
+    bool pass[4];
+    int count = 0;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        pass[dir] = CanPass(x + kDirX[dir], y + kDirY[dir]);
+        if (pass[dir])
+        {
+            outList[count] = GetIndex(x + kDirX[dir], y + kDirY[dir]);
+            outCosts[count] = kStepVal;
+            ++count;
+        }
+    }
+
+    if (corner_)
+    {
+        for (int dir = 4; dir < 8; ++dir)
+        {
+            // 不能穿过拐角
+            const int h = kDirX[dir] > 0 ? 0 : 1;
+            const int v = kDirY[dir] > 0 ? 2 : 3;
+            if (pass[h] && pass[v] && CanPass(x + kDirX[dir], y + kDirY[dir]))
+            {
+                outList[count] = GetIndex(x + kDirX[dir], y + kDirY[dir]);
+                outCosts[count] = kObliqueVal;
+                ++count;
+            }
+        }
+    }
+
+    return count;
+}
+
+// 到当前起点的估价，4方向为曼哈顿距离，8方向为对角距离
+int DStarLite::CalcHValue(uint32_t index) const
+{
+    const int dx = abs((int)(index % width_) - start_.x);
+    const int dy = abs((int)(index / width_) - start_.y);
+    if (corner_)
+    {
+        return (dx < dy ? dx : dy) * kObliqueVal + abs(dx - dy) * kStepVal;
+    }
+    return (dx + dy) * kStepVal;
+}
+
+void DStarLite::CalcKey(uint32_t index, int *outKey1, int *outKey2) const
+{
+    const Node &node = nodes_[index];
+    const int k2 = node.g < node.rhs ? node.g : node.rhs;
+    *outKey1 = k2 >= kInfinity ? kInfinity : k2 + CalcHValue(index) + km_;
+    *outKey2 = k2;
+}
+
+// 重新计算 rhs，并根据是否局部一致调整它在队列中的状态
+void DStarLite::UpdateVertex(uint32_t index)
+{
+    Node &node = nodes_[index];
+    if (index != GetIndex(end_.x, end_.y))
+    {
+        uint32_t neighbors[8];
+        int costs[8];
+        const int count = GetNeighbors(index, neighbors, costs);
+        int rhs = kInfinity;
+        for (int i = 0; i < count; ++i)
+        {
+            const int g = nodes_[neighbors[i]].g;
+            if (g < kInfinity && g + costs[i] < rhs)
+            {
+                rhs = g + costs[i];
+            }
+        }
+        node.rhs = rhs;
+    }
+
+    if (node.g != node.rhs)
+    {
+        CalcKey(index, &node.key1, &node.key2);
+        if (node.heapIndex == kInvalidIndex)
+        {
+            HeapPush(index);
+        }
+        else
+        {
+            HeapUpdate(index);
+        }
+    }
+    else if (node.heapIndex != kInvalidIndex)
+    {
+        HeapRemove(index);
+    }
+}
+
+void DStarLite::ComputeShortestPath()
+{
+    expandedCount_ = 0;
+
+    const uint32_t start = GetIndex(start_.x, start_.y);
+    uint32_t neighbors[8];
+    int costs[8];
+    while (!openList_.empty())
+    {
+        const uint32_t top = openList_.front();
+        Node &node = nodes_[top];
+
+        // 起点局部一致且队列中没有优先级更小的格子时，起点的 g 值就是最短距离
+        int startKey1, startKey2;
+        CalcKey(start, &startKey1, &startKey2);
+        const bool topLess = node.key1 < startKey1 || (node.key1 == startKey1 && node.key2 < startKey2);
+        if (!topLess && nodes_[start].rhs <= nodes_[start].g)
+        {
+            break;
+        }
+
+        const int oldKey1 = node.key1;
+        const int oldKey2 = node.key2;
+        CalcKey(top, &node.key1, &node.key2);
+        if (oldKey1 < node.key1 || (oldKey1 == node.key1 && oldKey2 < node.key2))
+        {
+            // 优先级是用旧的 km 算的，更新后重新排队
+            HeapUpdate(top);
+            continue;
+        }
+
+        ++expandedCount_;
+        const int count = GetNeighbors(top, neighbors, costs);
+        if (node.g > node.rhs)
+        {
+            node.g = node.rhs;
+            HeapRemove(top);
+        }
+        else
+        {
+            node.g = kInfinity;
+            UpdateVertex(top);
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            UpdateVertex(neighbors[i]);
+        }
+    }
+}
+
+bool DStarLite::KeyLess(uint32_t a, uint32_t b) const
+{
+    const Node &na = nodes_[a];
+    const Node &nb = nodes_[b];
+    return na.key1 < nb.key1 || (na.key1 == nb.key1 && na.key2 < nb.key2);
+}
+
+void DStarLite::HeapPush(uint32_t index)
+{
+    Node &node = nodes_[index];
+    CalcKey(index, &node.key1, &node.key2);
+    node.heapIndex = (uint32_t)openList_.size();
+    openList_.push_back(index);
+    PercolateUp(node.heapIndex);
+}
+
+void DStarLite::HeapRemove(uint32_t index)
+{
+    const uint32_t pos = nodes_[index].heapIndex;
+    assert(openList_[pos] == index);
+    nodes_[index].heapIndex = kInvalidIndex;
+
+    const uint32_t last = openList_.back();
+    openList_.pop_back();
+    if (pos < openList_.size())
+    {
+        openList_[pos] = last;
+        nodes_[last].heapIndex = pos;
+        HeapUpdate(last);
+    }
+}
+
+// 优先级可能升高也可能降低
+void DStarLite::HeapUpdate(uint32_t index)
+{
+    const uint32_t pos = nodes_[index].heapIndex;
+    if (pos > 0 && KeyLess(index, openList_[(pos - 1) / 2]))
+    {
+        PercolateUp(pos);
+    }
+    else
+    {
+        PercolateDown(pos);
+    }
+}
+
+void DStarLite::PercolateUp(uint32_t pos)
+{
+    const uint32_t index = openList_[pos];
+    while (pos > 0)
+    {
+        const uint32_t parent = (pos - 1) / 2;
+        if (!KeyLess(index, openList_[parent]))
+        {
+            break;
+        }
+        openList_[pos] = openList_[parent];
+        nodes_[openList_[pos]].heapIndex = pos;
+        pos = parent;
+    }
+    openList_[pos] = index;
+    nodes_[index].heapIndex = pos;
+}
+
+void DStarLite::PercolateDown(uint32_t pos)
+{
+    const uint32_t index = openList_[pos];
+    const uint32_t size = (uint32_t)openList_.size();
+    for (;;)
+    {
+        uint32_t child = pos * 2 + 1;
+        if (child >= size)
+        {
+            break;
+        }
+        if (child + 1 < size && KeyLess(openList_[child + 1], openList_[child]))
+        {
+            ++child;
+        }
+        if (!KeyLess(openList_[child], index))
+        {
+            break;
+        }
+        openList_[pos] = openList_[child];
+        nodes_[openList_[pos]].heapIndex = pos;
+        pos = child;
+    }
+    openList_[pos] = index;
+    nodes_[index].heapIndex = pos;
+}
@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 增量寻路（D* Lite）
+* 参考：Koenig, Likhachev, D* Lite (2002)
+*
+* 从终点向起点反向搜索，每个格子保存 g 值和一步前瞻值 rhs，两者不相等的格子在优先队列中。
+* 地图格子变化后只重新计算这些格子及其相邻格子的 rhs，
+* 再次 Find 时只扩展受影响的部分，而不是从头搜索。
+* 起点移动（单位沿路径前进）时通过累加 km 修正优先级，不需要重建队列。
+*
+* 每个单位使用一个 DStarLite，内存占用与地图大小成正比。
+* 移动规则与 AStar 一致：corner 为 true 时可以斜角移动，但不能穿过拐角。
+* 起点和终点必须可通过。
+*/
+
+class DStarLite final
+{
+public:
+    DStarLite();
+    ~DStarLite();
+
+    /**
+     * 初始化搜索，使用 param 中的 width、height、corner、start、end、canPass、passGrid
+     * canPass 或 passGrid 会被保存，之后的 Find 和 UpdateCells 都从它读取地图
+     */
+    bool Init(const AStar::Params &param);
+
+    /**
+     * 地图格子可通过性变化后调用，changedCells 为变化的格子
+     */
+    void UpdateCells(const std::vector<AStar::Vec2> &changedCells);
+
+    /**
+     * 单位移动到新的起点
+     */
+    void MoveStart(const AStar::Vec2 &start);
+
+    /**
+     * 修复搜索状态并返回从起点到终点的路径，格式与 AStar::Find 一致（不含起点，逐格）
+     * 终点不可达时返回空
+     */
+    std::vector<AStar::Vec2> Find();
+
+    /**
+     * 最近一次 Find 扩展的格子数
+     */
+    size_t GetExpandedCount() const { return expandedCount_; }
+
+private:
+    struct Node
+    {
+        int g;
+        int rhs;
+        int key1; // 优先级，按(key1,key2)字典序比较
+        int key2;
+        uint32_t heapIndex; // 在优先队列中的位置，kInvalidIndex 表示不在队列中
+    };
+
+    static const int kInfinity = 0x3FFFFFFF;
+    static const uint32_t kInvalidIndex = UINT32_MAX;
+
+private:
+    uint32_t GetIndex(int x, int y) const { return (uint32_t)y * width_ + x; }
+    bool CanPass(int x, int y) const;
+    int GetNeighbors(uint32_t index, uint32_t *outList, int *outCosts) const;
+    int CalcHValue(uint32_t index) const;
+    void CalcKey(uint32_t index, int *outKey1, int *outKey2) const;
+    void UpdateVertex(uint32_t index);
+    void ComputeShortestPath();
+
+    bool KeyLess(uint32_t a, uint32_t b) const;
+    void HeapPush(uint32_t index);
+    void HeapRemove(uint32_t index);
+    void HeapUpdate(uint32_t index);
+    void PercolateUp(uint32_t pos);
+    void PercolateDown(uint32_t pos);
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    bool corner_;
+    AStar::Vec2 start_;
+    AStar::Vec2 end_;
+    AStar::Vec2 last_; // 上次计算 km 时的起点
+    int km_; // 起点移动累计的估价修正
+    AStar::CanPassFunc canPass_;
+    const BitGrid *passGrid_;
+    size_t expandedCount_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> openList_; // 以(key1,key2)为序的最小堆
+};
@@ -0,0 +1,185 @@
+﻿#include <assert.h>
+#include <algorithm>
+#include <functional>
+#include "astar/flowfield.h"
+
+static const int kStepVal = 10;
+static const int kObliqueVal = 14;
+
+// 偏移量超过它时重新计算整个流场，避免溢出
+static const int32_t kMaxBias = 1 << 29;
+
+const int32_t FlowField::kUnreachable;
+const uint8_t FlowField::kNoDirection;
+
+// 前4个是正交方向，dir ^ 1 是相反方向
+const int FlowField::kDirX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+const int FlowField::kDirY[8] = { 0, 0, 1, -1, 1, -1, -1, 1 };
+
+FlowField::FlowField() :
+    width_(0),
+    height_(0),
+    corner_(false),
+    hasTarget_(false),
+    bias_(0),
+    updatedCount_(0)
+{
+}
+
+FlowField::~FlowField()
+{
+}
+
+void FlowField::Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass)
+{
+    width_ = width;
+    height_ = height;
+    corner_ = corner;
+    canPass_ = canPass;
+    hasTarget_ = false;
+    bias_ = 0;
+    dist_.assign((size_t)width_ * height_, kUnreachable);
+    dirs_.assign((size_t)width_ * height_, kNoDirection);
+}
+
+void FlowField::SetTarget(const AStar::Vec2 &target)
+{
+    assert(target.x < width_ && target.y < height_);
+    target_ = target;
+    hasTarget_ = true;
+    bias_ = 0;
+    updatedCount_ = 0;
+    std::fill(dist_.begin(), dist_.end(), kUnreachable);
+    std::fill(dirs_.begin(), dirs_.end(), kNoDirection);
+
+    if (!CanPass(target.x, target.y))
+    {
+        return;
+    }
+
+    const uint32_t index = (uint32_t)target.y * width_ + target.x;
+    dist_[index] = 0;
+    openList_.clear();
+    openList_.push_back(std::make_pair(0, index));
+    Propagate(kUnreachable);
+}
+
+void FlowField::MoveTarget(const AStar::Vec2 &target, int32_t repairRadius)
+{
+    assert(target.x < width_ && target.y < height_);
+    if (!hasTarget_ || target == target_)
+    {
+        SetTarget(target);
+        return;
+    }
+
+    // 只能处理从旧目标一步走到新目标的情况
+    int dir = 0;
+    const int count = corner_ ? 8 : 4;
+    while (dir < count && !(target_.x + kDirX[dir] == target.x && target_.y + kDirY[dir] == target.y))
+    {
+        ++dir;
+    }
+
+    const uint32_t from = (uint32_t)target_.y * width_ + target_.x;
+    if (dir == count || !CanMove(target_.x, target_.y, dir) || dist_[from] == kUnreachable || bias_ > kMaxBias)
+    {
+        SetTarget(target);
+        return;
+    }
+
+    // 所有格子经由旧目标走到新目标，距离统一增加一步
+    const int32_t cost = dir < 4 ? kStepVal : kObliqueVal;
+    bias_ += cost;
+    dist_[from] = cost - bias_;
+    dirs_[from] = (uint8_t)dir;
+    target_ = target;
+    updatedCount_ = 0;
+
+    // 新目标距离为0，只向外传播变短的距离
+    const uint32_t index = (uint32_t)target.y * width_ + target.x;
+    dist_[index] = -bias_;
+    dirs_[index] = kNoDirection;
+    openList_.clear();
+    openList_.push_back(std::make_pair(0, index));
+    Propagate(repairRadius);
+}
+
+bool FlowField::CanPass(int x, int y) const
+{
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? canPass_(AStar::Vec2(x, y)) : false;
+}
+
+// 能否从(x,y)沿 dir 走一步，(x,y)本身可以不可通过
+bool FlowField::CanMove(int x, int y, int dir) const
+{
+    const int dx = kDirX[dir];
+    const int dy = kDirY[dir];
+    if (dx != 0 && dy != 0 && (!CanPass(x + dx, y) || !CanPass(x, y + dy)))
+    {
+        return false;
+    }
+    return CanPass(x + dx, y + dy);
+}
+
+// 从开启列表向外做 Dijkstra，只接受更短的距离，实际距离超过 maxDist 后停止
+void FlowField::Propagate(int32_t maxDist)
+{
+    typedef std::pair<int32_t, uint32_t> Entry;
+    const std::greater<Entry> cmp;
+    const int count = corner_ ? 8 : 4;
+    while (!openList_.empty())
+    {
+        std::pop_heap(openList_.begin(), openList_.end(), cmp);
+        const Entry top = openList_.back();
+        openList_.pop_back();
+
+        const uint32_t index = top.second;
+        if (top.first != dist_[index] + bias_)
+        {
+            continue; // 已经有更短的距离
+        }
+        if (top.first > maxDist)
+        {
+            break;
+        }
+
+        ++updatedCount_;
+        const int x = index % width_;
+        const int y = index / width_;
+        for (int dir = 0; dir < count; ++dir)
+        {
+            const int nx = x + kDirX[dir];
+            const int ny = y + kDirY[dir];
+            if (nx < 0 || nx >= width_ || ny < 0 || ny >= height_)
+            {
+                continue;
+            }
+
+            // 反向：检查能否从相邻格子走到当前格子
+            const int back = dir ^ 1;
+            if (!CanMove(nx, ny, back))
+            {
+                continue;
+            }
+
+            const uint32_t next = (uint32_t)ny * width_ + nx;
+            const int32_t dist = top.first + (dir < 4 ? kStepVal : kObliqueVal);
+            if (dist_[next] != kUnreachable && dist >= dist_[next] + bias_)
+            {
+                continue;
+            }
+
+            dist_[next] = dist - bias_;
+            dirs_[next] = (uint8_t)back;
+
+            // 不可通过的格子只能作为出发点，不再向外传播
+            if (CanPass(nx, ny))
+            {
+                openList_.push_back(std::make_pair(dist, next));
+                std::push_heap(openList_.begin(), openList_.end(), cmp);
+            }
+        }
+    }
+    openList_.clear();
+}
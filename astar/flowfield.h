@@ -0,0 +1,96 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 流场寻路：大量单位前往同一个目标
+*
+* 从目标出发做一次 Dijkstra，得到每个格子到目标的距离和下一步的方向，
+* 单位每一步只需 O(1) 查表，不需要各自调用 AStar::Find。
+* 移动规则与 AStar 一致：corner 为 true 时可以斜角移动，但不能穿过拐角；
+* 单位所在的格子可以不可通过，目标必须可通过。
+*
+* 目标移动到相邻格子时调用 MoveTarget 增量更新：
+* 所有格子先经由旧目标走到新目标，距离统一加上一步的代价（只修改偏移量），
+* 再从新目标向外只更新距离变短的格子。
+* 可以限制更新半径，半径外的格子仍能沿方向到达目标，只是路径可能略长。
+*/
+
+class FlowField final
+{
+public:
+    static const int32_t kUnreachable = INT32_MAX;
+
+public:
+    FlowField();
+    ~FlowField();
+
+    /**
+     * canPass 会被保存，之后计算流场时用来读取地图
+     */
+    void Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass);
+
+    /**
+     * 以 target 为目标重新计算整个流场
+     */
+    void SetTarget(const AStar::Vec2 &target);
+
+    /**
+     * 目标移动到相邻格子，只更新与新目标距离不超过 repairRadius 且距离变短的格子
+     * 不是相邻格子或无法一步走到时重新计算整个流场
+     */
+    void MoveTarget(const AStar::Vec2 &target, int32_t repairRadius = kUnreachable);
+
+    const AStar::Vec2& GetTarget() const { return target_; }
+
+    /**
+     * pos 下一步应该走到的格子，已在目标上或无法到达时返回 false
+     */
+    bool GetNext(const AStar::Vec2 &pos, AStar::Vec2 *outNext) const
+    {
+        const uint8_t dir = dirs_[(size_t)pos.y * width_ + pos.x];
+        if (dir == kNoDirection)
+        {
+            return false;
+        }
+        outNext->Reset(pos.x + kDirX[dir], pos.y + kDirY[dir]);
+        return true;
+    }
+
+    /**
+     * pos 沿流场走到目标的代价，无法到达时返回 kUnreachable
+     */
+    int32_t GetDistance(const AStar::Vec2 &pos) const
+    {
+        const int32_t dist = dist_[(size_t)pos.y * width_ + pos.x];
+        return dist == kUnreachable ? kUnreachable : dist + bias_;
+    }
+
+    /**
+     * 最近一次 SetTarget 或 MoveTarget 更新的格子数
+     */
+    size_t GetUpdatedCount() const { return updatedCount_; }
+
+private:
+    static const uint8_t kNoDirection = 0xFF;
+    static const int kDirX[8];
+    static const int kDirY[8];
+
+    bool CanPass(int x, int y) const;
+    bool CanMove(int x, int y, int dir) const;
+    void Propagate(int32_t maxDist);
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    bool corner_;
+    AStar::CanPassFunc canPass_;
+    AStar::Vec2 target_;
+    bool hasTarget_;
+    int32_t bias_; // 所有距离共同的偏移量，格子的实际距离为 dist_ + bias_
+    size_t updatedCount_;
+    std::vector<int32_t> dist_; // 不含 bias_ 的距离，kUnreachable 表示无法到达
+    std::vector<uint8_t> dirs_; // 下一步的方向，kNoDirection 表示没有
+    std::vector<std::pair<int32_t, uint32_t>> openList_; // (实际距离, 格子下标) 的最小堆
+};
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+* 网格数据的分块布局
+*
+* 按行平铺时上下相邻的格子相隔整张地图的宽度，4096 宽的地图上每次扩展都要访问多个相距很远的缓存行。
+* 分块布局把网格切成 2^shift x 2^shift 的块，块内按行平铺，块之间也按行排列，
+* 3x3 邻域大多落在同一块内，上下相邻的格子只相隔一块的宽度。
+* 宽高向上补齐到块的整数倍，补齐的格子不使用。
+*
+* shift 为 0 时每块只有一个格子，与按行平铺完全相同。
+*/
+
+class GridLayout final
+{
+public:
+    static const unsigned kTileShift = 3; // 默认 8x8 一块
+
+public:
+    GridLayout() : shift_(0), mask_(0), tilesPerRow_(0), size_(0) {}
+
+    void Reset(uint16_t width, uint16_t height, unsigned shift)
+    {
+        shift_ = shift;
+        mask_ = (1u << shift) - 1;
+        tilesPerRow_ = ((size_t)width + mask_) >> shift;
+        size_ = (tilesPerRow_ * (((size_t)height + mask_) >> shift)) << (shift * 2);
+    }
+
+    /**
+     * 包括补齐格子在内的数组长度
+     */
+    size_t GetSize() const { return size_; }
+
+    unsigned GetShift() const { return shift_; }
+
+    /**
+     * (x,y)在数组中的下标，调用者保证在地图内
+     */
+    size_t Index(int x, int y) const
+    {
+        const size_t tile = (size_t)(y >> shift_) * tilesPerRow_ + (x >> shift_);
+        return (tile << (shift_ * 2)) | ((size_t)(y & mask_) << shift_) | (x & mask_);
+    }
+
+private:
+    unsigned shift_;
+    unsigned mask_;
+    size_t tilesPerRow_;
+    size_t size_;
+};
@@ -0,0 +1,550 @@
+﻿#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include "astar/hpastar.h"
+
+static const int kStepVal = 10;
+static const int kObliqueVal = 14;
+
+// 入口宽度小于该值时只取中间一个格子，否则取两端两个格子
+static const int kMaxSingleTransitionWidth = 6;
+
+#define MIN(x,y) ((x)<(y) ? (x) : (y))
+#define MAX(x,y) ((x)>(y) ? (x) : (y))
+
+HPAStar::HPAStar() :
+    width_(0),
+    height_(0),
+    corner_(false),
+    clusterSize_(0),
+    clusterCols_(0),
+    clusterRows_(0),
+    entranceCount_(0),
+    canPass_(nullptr)
+{
+}
+
+HPAStar::~HPAStar()
+{
+}
+
+void HPAStar::Build(uint16_t width, uint16_t height, bool corner, uint16_t clusterSize, const AStar::CanPassFunc &canPass)
+{
+    assert(width > 0 && height > 0 && clusterSize > 0 && canPass != nullptr);
+
+    width_ = width;
+    height_ = height;
+    corner_ = corner;
+    clusterSize_ = clusterSize;
+    canPass_ = canPass;
+    clusterCols_ = (width_ + clusterSize_ - 1) / clusterSize_;
+    clusterRows_ = (height_ + clusterSize_ - 1) / clusterSize_;
+
+    clusters_.clear();
+    clusters_.resize((size_t)clusterCols_ * clusterRows_);
+    for (int cy = 0; cy < clusterRows_; ++cy)
+    {
+        for (int cx = 0; cx < clusterCols_; ++cx)
+        {
+            Cluster &cluster = clusters_[cy * clusterCols_ + cx];
+            cluster.x = (uint16_t)(cx * clusterSize_);
+            cluster.y = (uint16_t)(cy * clusterSize_);
+            cluster.width = (uint16_t)MIN(clusterSize_, width_ - cluster.x);
+            cluster.height = (uint16_t)MIN(clusterSize_, height_ - cluster.y);
+            cluster.offset = 0;
+        }
+    }
+
+    for (int cy = 0; cy < clusterRows_; ++cy)
+    {
+        for (int cx = 0; cx < clusterCols_; ++cx)
+        {
+            BuildTransitions(cx, cy);
+        }
+    }
+
+    for (auto &cluster : clusters_)
+    {
+        BuildCluster(cluster);
+    }
+
+    UpdateOffsets();
+}
+
+void HPAStar::Update(const std::vector<AStar::Vec2> &changedCells)
+{
+    if (clusters_.empty())
+    {
+        return;
+    }
+
+    std::vector<char> dirty(clusters_.size(), 0);
+    for (const auto &pos : changedCells)
+    {
+        if (pos.x < width_ && pos.y < height_)
+        {
+            dirty[GetClusterIndex(pos)] = 1;
+        }
+    }
+
+    // 变化的簇重新选取四条边上的入口，相邻簇的入口随之变化也要重建
+    std::vector<char> affected(clusters_.size(), 0);
+    for (int cy = 0; cy < clusterRows_; ++cy)
+    {
+        for (int cx = 0; cx < clusterCols_; ++cx)
+        {
+            if (!dirty[cy * clusterCols_ + cx])
+            {
+                continue;
+            }
+
+            BuildTransitions(cx, cy);
+            if (cx > 0)
+            {
+                BuildTransitions(cx - 1, cy);
+            }
+            if (cy > 0)
+            {
+                BuildTransitions(cx, cy - 1);
+            }
+
+            affected[cy * clusterCols_ + cx] = 1;
+            if (cx > 0) affected[cy * clusterCols_ + cx - 1] = 1;
+            if (cx + 1 < clusterCols_) affected[cy * clusterCols_ + cx + 1] = 1;
+            if (cy > 0) affected[(cy - 1) * clusterCols_ + cx] = 1;
+            if (cy + 1 < clusterRows_) affected[(cy + 1) * clusterCols_ + cx] = 1;
+        }
+    }
+
+    for (size_t i = 0; i < clusters_.size(); ++i)
+    {
+        if (affected[i])
+        {
+            BuildCluster(clusters_[i]);
+        }
+    }
+
+    UpdateOffsets();
+}
+
+inline int HPAStar::GetClusterIndex(const AStar::Vec2 &pos) const
+{
+    return (pos.y / clusterSize_) * clusterCols_ + pos.x / clusterSize_;
+}
+
+inline uint32_t HPAStar::GetCellKey(const AStar::Vec2 &pos) const
+{
+    return (uint32_t)pos.y * width_ + pos.x;
+}
+
+inline bool HPAStar::CanPass(int x, int y) const
+{
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? canPass_(AStar::Vec2(x, y)) : false;
+}
+
+// 选取本簇右边界和下边界上的入口
+void HPAStar::BuildTransitions(int cx, int cy)
+{
+    Cluster &cluster = clusters_[cy * clusterCols_ + cx];
+
+    // 把边界上连续可通过的一段作为一个入口，按宽度选取一到两个格子
+    auto addRun = [](std::vector<AStar::Vec2> &out, int begin, int end, const std::function<AStar::Vec2(int)> &toPos) {
+        const int len = end - begin;
+        if (len < kMaxSingleTransitionWidth)
+        {
+            out.push_back(toPos(begin + len / 2));
+        }
+        else
+        {
+            out.push_back(toPos(begin));
+            out.push_back(toPos(end - 1));
+        }
+    };
+
+    cluster.rightTransitions.clear();
+    if (cx + 1 < clusterCols_)
+    {
+        const int x = cluster.x + cluster.width - 1;
+        auto toPos = [x](int y) { return AStar::Vec2(x, y); };
+        int begin = -1;
+        for (int y = cluster.y; y <= cluster.y + cluster.height; ++y)
+        {
+            const bool open = y < cluster.y + cluster.height && CanPass(x, y) && CanPass(x + 1, y);
+            if (open && begin < 0)
+            {
+                begin = y;
+            }
+            else if (!open && begin >= 0)
+            {
+                addRun(cluster.rightTransitions, begin, y, toPos);
+                begin = -1;
+            }
+        }
+    }
+
+    cluster.downTransitions.clear();
+    if (cy + 1 < clusterRows_)
+    {
+        const int y = cluster.y + cluster.height - 1;
+        auto toPos = [y](int x) { return AStar::Vec2(x, y); };
+        int begin = -1;
+        for (int x = cluster.x; x <= cluster.x + cluster.width; ++x)
+        {
+            const bool open = x < cluster.x + cluster.width && CanPass(x, y) && CanPass(x, y + 1);
+            if (open && begin < 0)
+            {
+                begin = x;
+            }
+            else if (!open && begin >= 0)
+            {
+                addRun(cluster.downTransitions, begin, x, toPos);
+                begin = -1;
+            }
+        }
+    }
+}
+
+// 收集四条边上的入口作为抽象节点，并预计算簇内代价
+void HPAStar::BuildCluster(Cluster &cluster)
+{
+    cluster.entrances.clear();
+    cluster.links.clear();
+    cluster.index.clear();
+
+    auto addEntrance = [&](const AStar::Vec2 &pos, const AStar::Vec2 &link) {
+        const uint32_t key = GetCellKey(pos);
+        auto iter = cluster.index.find(key);
+        if (iter == cluster.index.end())
+        {
+            iter = cluster.index.emplace(key, (int)cluster.entrances.size()).first;
+            cluster.entrances.push_back(pos);
+            cluster.links.emplace_back();
+        }
+        cluster.links[iter->second].push_back(link);
+    };
+
+    for (const auto &pos : cluster.rightTransitions)
+    {
+        addEntrance(pos, AStar::Vec2(pos.x + 1, pos.y));
+    }
+    for (const auto &pos : cluster.downTransitions)
+    {
+        addEntrance(pos, AStar::Vec2(pos.x, pos.y + 1));
+    }
+
+    const int cx = cluster.x / clusterSize_;
+    const int cy = cluster.y / clusterSize_;
+    if (cx > 0)
+    {
+        for (const auto &pos : clusters_[cy * clusterCols_ + cx - 1].rightTransitions)
+        {
+            addEntrance(AStar::Vec2(pos.x + 1, pos.y), pos);
+        }
+    }
+    if (cy > 0)
+    {
+        for (const auto &pos : clusters_[(cy - 1) * clusterCols_ + cx].downTransitions)
+        {
+            addEntrance(AStar::Vec2(pos.x, pos.y + 1), pos);
+        }
+    }
+
+    const size_t count = cluster.entrances.size();
+    cluster.costs.assign(count * count, -1);
+    std::vector<int> costs;
+    LoadClusterCells(cluster);
+    for (size_t i = 0; i < count; ++i)
+    {
+        CalcEntranceCosts(cluster, cluster.entrances[i], &costs);
+        std::copy(costs.begin(), costs.end(), cluster.costs.begin() + i * count);
+    }
+}
+
+void HPAStar::UpdateOffsets()
+{
+    entranceCount_ = 0;
+    for (auto &cluster : clusters_)
+    {
+        cluster.offset = (int)entranceCount_;
+        entranceCount_ += cluster.entrances.size();
+    }
+}
+
+// 缓存簇内格子的可通过性，避免 Dijkstra 中反复调用 canPass
+void HPAStar::LoadClusterCells(const Cluster &cluster)
+{
+    cellCache_.resize((size_t)cluster.width * cluster.height);
+    for (int y = 0; y < cluster.height; ++y)
+    {
+        for (int x = 0; x < cluster.width; ++x)
+        {
+            cellCache_[y * cluster.width + x] = CanPass(cluster.x + x, cluster.y + y) ? 1 : 0;
+        }
+    }
+}
+
+// 在簇内从 from 做一次 Dijkstra，得到到达各入口的代价，不可达为 -1
+// 调用前需先 LoadClusterCells
+void HPAStar::CalcEntranceCosts(const Cluster &cluster, const AStar::Vec2 &from, std::vector<int> *outCosts)
+{
+    const int w = cluster.width;
+    const int h = cluster.height;
+    costCache_.assign((size_t)w * h, INT_MAX);
+
+    auto pass = [&](int x, int y) {
+        return x >= 0 && x < w && y >= 0 && y < h && cellCache_[y * w + x] != 0;
+    };
+
+    using OpenItem = std::pair<int, int>; // g, local index
+    std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> openList;
+    const int fromIndex = (from.y - cluster.y) * w + (from.x - cluster.x);
+    costCache_[fromIndex] = 0;
+    openList.push(OpenItem(0, fromIndex));
+
+    while (!openList.empty())
+    {
+        const OpenItem item = openList.top();
+        openList.pop();
+        if (item.first > costCache_[item.second])
+        {
+            continue;
+        }
+
+        const int x = item.second % w;
+        const int y = item.second / w;
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if ((dx == 0 && dy == 0) || !pass(x + dx, y + dy))
+                {
+                    continue;
+                }
+
+                int cost = kStepVal;
+                if (dx != 0 && dy != 0)
+                {
+                    if (!corner_ || !pass(x + dx, y) || !pass(x, y + dy))
+                    {
+                        continue;
+                    }
+                    cost = kObliqueVal;
+                }
+
+                const int index = (y + dy) * w + x + dx;
+                if (item.first + cost < costCache_[index])
+                {
+                    costCache_[index] = item.first + cost;
+                    openList.push(OpenItem(costCache_[index], index));
+                }
+            }
+        }
+    }
+
+    outCosts->resize(cluster.entrances.size());
+    for (size_t i = 0; i < cluster.entrances.size(); ++i)
+    {
+        const AStar::Vec2 &pos = cluster.entrances[i];
+        const int cost = costCache_[(pos.y - cluster.y) * w + (pos.x - cluster.x)];
+        (*outCosts)[i] = cost == INT_MAX ? -1 : cost;
+    }
+}
+
+// 限制在簇内寻路
+bool HPAStar::FindInCluster(const Cluster &cluster, const AStar::Vec2 &start, const AStar::Vec2 &end, std::vector<AStar::Vec2> *outPath)
+{
+    outPath->clear();
+    if (start == end)
+    {
+        return true;
+    }
+
+    const int minX = cluster.x;
+    const int minY = cluster.y;
+    const int maxX = cluster.x + cluster.width;
+    const int maxY = cluster.y + cluster.height;
+    const AStar::CanPassFunc &canPass = canPass_;
+
+    AStar::Params param;
+    param.width = width_;
+    param.height = height_;
+    param.corner = corner_;
+    param.start = start;
+    param.end = end;
+    param.canPass = [&](const AStar::Vec2 &pos) {
+        return pos.x >= minX && pos.x < maxX && pos.y >= minY && pos.y < maxY && canPass(pos);
+    };
+
+    *outPath = astar_.Find(param);
+    return !outPath->empty();
+}
+
+int HPAStar::CalcHValue(const AStar::Vec2 &a, const AStar::Vec2 &b) const
+{
+    const int dx = abs(a.x - b.x);
+    const int dy = abs(a.y - b.y);
+    if (corner_)
+    {
+        return MIN(dx, dy) * kObliqueVal + (MAX(dx, dy) - MIN(dx, dy)) * kStepVal;
+    }
+    return (dx + dy) * kStepVal;
+}
+
+std::vector<AStar::Vec2> HPAStar::Find(const AStar::Vec2 &start, const AStar::Vec2 &end)
+{
+    std::vector<AStar::Vec2> paths;
+    if (clusters_.empty()
+        || start.x >= width_ || start.y >= height_
+        || end.x >= width_ || end.y >= height_)
+    {
+        assert(false);
+        return paths;
+    }
+
+    if (start == end || !CanPass(start.x, start.y) || !CanPass(end.x, end.y))
+    {
+        return paths;
+    }
+
+    const int startCluster = GetClusterIndex(start);
+    const int endCluster = GetClusterIndex(end);
+
+    // 起点终点在同一个簇内时先尝试簇内直达
+    if (startCluster == endCluster && FindInCluster(clusters_[startCluster], start, end, &paths))
+    {
+        return paths;
+    }
+
+    // 抽象图节点编号：各簇入口依次编号，最后两个分别是起点和终点
+    const int startId = (int)entranceCount_;
+    const int endId = startId + 1;
+    std::vector<int> gValues(entranceCount_ + 2, INT_MAX);
+    std::vector<int> parents(entranceCount_ + 2, -1);
+    std::vector<char> closed(entranceCount_ + 2, 0);
+    std::vector<AStar::Vec2> positions(entranceCount_ + 2);
+    std::vector<int> owners(entranceCount_ + 2, -1);
+    for (size_t c = 0; c < clusters_.size(); ++c)
+    {
+        const Cluster &cluster = clusters_[c];
+        for (size_t i = 0; i < cluster.entrances.size(); ++i)
+        {
+            positions[cluster.offset + i] = cluster.entrances[i];
+            owners[cluster.offset + i] = (int)c;
+        }
+    }
+    positions[startId] = start;
+    positions[endId] = end;
+
+    using OpenItem = std::pair<int, int>; // f, id
+    std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> openList;
+    auto relax = [&](int from, int to, int cost) {
+        const int g = gValues[from] + cost;
+        if (!closed[to] && g < gValues[to])
+        {
+            gValues[to] = g;
+            parents[to] = from;
+            openList.push(OpenItem(g + CalcHValue(positions[to], end), to));
+        }
+    };
+
+    // 把起点和终点接入所在簇的入口
+    std::vector<int> costs;
+    gValues[startId] = 0;
+    const Cluster &sc = clusters_[startCluster];
+    LoadClusterCells(sc);
+    CalcEntranceCosts(sc, start, &costs);
+    for (size_t i = 0; i < costs.size(); ++i)
+    {
+        if (costs[i] >= 0)
+        {
+            relax(startId, sc.offset + (int)i, costs[i]);
+        }
+    }
+
+    std::vector<int> endCosts;
+    LoadClusterCells(clusters_[endCluster]);
+    CalcEntranceCosts(clusters_[endCluster], end, &endCosts);
+
+    // 在抽象图上搜索
+    while (!openList.empty())
+    {
+        const int id = openList.top().second;
+        openList.pop();
+        if (closed[id])
+        {
+            continue;
+        }
+        closed[id] = 1;
+
+        if (id == endId)
+        {
+            break;
+        }
+
+        const int c = owners[id];
+        const Cluster &cluster = clusters_[c];
+        const int local = id - cluster.offset;
+        const size_t count = cluster.entrances.size();
+        for (size_t j = 0; j < count; ++j)
+        {
+            const int cost = cluster.costs[local * count + j];
+            if (cost > 0)
+            {
+                relax(id, cluster.offset + (int)j, cost);
+            }
+        }
+
+        for (const auto &link : cluster.links[local])
+        {
+            const Cluster &other = clusters_[GetClusterIndex(link)];
+            auto iter = other.index.find(GetCellKey(link));
+            assert(iter != other.index.end());
+            relax(id, other.offset + iter->second, kStepVal);
+        }
+
+        if (c == endCluster && endCosts[local] >= 0)
+        {
+            relax(id, endId, endCosts[local]);
+        }
+    }
+
+    if (!closed[endId])
+    {
+        return paths;
+    }
+
+    // 细化：跨簇的相邻格子直接连接，簇内的两个抽象节点之间用 AStar 补全
+    std::vector<AStar::Vec2> waypoints;
+    for (int id = endId; id != -1; id = parents[id])
+    {
+        waypoints.push_back(positions[id]);
+    }
+    std::reverse(waypoints.begin(), waypoints.end());
+
+    std::vector<AStar::Vec2> segment;
+    for (size_t i = 1; i < waypoints.size(); ++i)
+    {
+        const AStar::Vec2 &from = waypoints[i - 1];
+        const AStar::Vec2 &to = waypoints[i];
+        const int fromCluster = GetClusterIndex(from);
+        if (fromCluster != GetClusterIndex(to))
+        {
+            paths.push_back(to);
+        }
+        else if (FindInCluster(clusters_[fromCluster], from, to, &segment))
+        {
+            paths.insert(paths.end(), segment.begin(), segment.end());
+        }
+        else
+        {
+            assert(false);
+            paths.clear();
+            break;
+        }
+    }
+
+    return paths;
+}
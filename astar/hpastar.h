@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 分层寻路（HPA*）
+* 参考：Botea, Müller, Schaeffer, Near Optimal Hierarchical Path-Finding (2004)
+*
+* 把地图划分为固定大小的簇，在相邻簇的边界上选出入口格子，
+* 预计算同一簇内入口之间的代价，组成一张抽象图。
+* 寻路时先在抽象图上搜索，再用 AStar 在簇内细化相邻抽象节点之间的路径。
+* 返回的路径接近最优，但不保证最优。
+*
+* 地图格子变化后调用 Update，只重建受影响的簇及其相邻的簇。
+*/
+
+class HPAStar final
+{
+public:
+    HPAStar();
+    ~HPAStar();
+
+    /**
+     * 划分簇并预计算抽象图
+     * canPass 会被保存，寻路和 Update 时用来读取地图
+     */
+    void Build(uint16_t width, uint16_t height, bool corner, uint16_t clusterSize, const AStar::CanPassFunc &canPass);
+
+    /**
+     * 地图格子变化后重建受影响的簇
+     */
+    void Update(const std::vector<AStar::Vec2> &changedCells);
+
+    /**
+     * 寻路，返回的路径格式与 AStar::Find 一致（不含起点，逐格）
+     */
+    std::vector<AStar::Vec2> Find(const AStar::Vec2 &start, const AStar::Vec2 &end);
+
+    /**
+     * 抽象图上的节点总数
+     */
+    size_t GetEntranceCount() const { return entranceCount_; }
+
+private:
+    /**
+     * 簇
+     */
+    struct Cluster
+    {
+        uint16_t x; // 左上角坐标
+        uint16_t y;
+        uint16_t width;
+        uint16_t height;
+        std::vector<AStar::Vec2> rightTransitions; // 与右侧簇之间的入口（本簇一侧的格子）
+        std::vector<AStar::Vec2> downTransitions; // 与下方簇之间的入口（本簇一侧的格子）
+        std::vector<AStar::Vec2> entrances; // 本簇内的抽象节点
+        std::vector<std::vector<AStar::Vec2>> links; // 每个抽象节点在相邻簇中连接的格子
+        std::vector<int> costs; // 抽象节点之间的代价，entrances.size() 的方阵，-1 表示不可达
+        std::unordered_map<uint32_t, int> index; // 格子 -> 抽象节点下标
+        int offset; // 抽象节点在全局编号中的起始值
+    };
+
+private:
+    int GetClusterIndex(const AStar::Vec2 &pos) const;
+    uint32_t GetCellKey(const AStar::Vec2 &pos) const;
+    bool CanPass(int x, int y) const;
+
+    void BuildTransitions(int cx, int cy);
+    void BuildCluster(Cluster &cluster);
+    void UpdateOffsets();
+
+    void LoadClusterCells(const Cluster &cluster);
+    void CalcEntranceCosts(const Cluster &cluster, const AStar::Vec2 &from, std::vector<int> *outCosts);
+    bool FindInCluster(const Cluster &cluster, const AStar::Vec2 &start, const AStar::Vec2 &end, std::vector<AStar::Vec2> *outPath);
+    int CalcHValue(const AStar::Vec2 &a, const AStar::Vec2 &b) const;
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    bool corner_;
+    uint16_t clusterSize_;
+    int clusterCols_;
+    int clusterRows_;
+    size_t entranceCount_;
+    AStar::CanPassFunc canPass_;
+    std::vector<Cluster> clusters_;
+    std::vector<char> cellCache_; // LoadClusterCells 缓存的簇内可通过性
+    std::vector<int> costCache_; // CalcEntranceCosts 使用的簇内代价缓存
+    AStar astar_; // 簇内寻路，节点数组覆盖整张地图，跨簇复用
+};
@@ -0,0 +1,130 @@
+﻿#include <assert.h>
+#include "astar/jumptable.h"
+
+// 距离超出 int16_t 时在中途插入一个跳点，保证值不溢出
+static const int kMaxJumpDist = INT16_MAX;
+
+const int JumpTable::kDirX[DIR_COUNT] = { 1, -1, 0, 0, 1, 1, -1, -1 };
+const int JumpTable::kDirY[DIR_COUNT] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+
+JumpTable::JumpTable() :
+    width_(0),
+    height_(0),
+    corner_(false)
+{
+}
+
+JumpTable::~JumpTable()
+{
+}
+
+int JumpTable::GetDirection(int dx, int dy)
+{
+    for (int dir = 0; dir < DIR_COUNT; ++dir)
+    {
+        if (kDirX[dir] == dx && kDirY[dir] == dy)
+        {
+            return dir;
+        }
+    }
+    assert(false);
+    return DIR_COUNT;
+}
+
+void JumpTable::Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass)
+{
+    width_ = width;
+    height_ = height;
+    corner_ = corner;
+    dist_.clear();
+    dist_.resize((size_t)width_ * height_ * DIR_COUNT, 0);
+
+    // 先缓存一份可通过性，避免每个方向重复调用 canPass
+    std::vector<char> passable((size_t)width_ * height_, 0);
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
+        {
+            passable[(size_t)y * width_ + x] = canPass(AStar::Vec2(x, y)) ? 1 : 0;
+        }
+    }
+
+    // 斜角方向依赖正交方向的结果，4方向时竖直方向依赖水平方向的结果
+    BuildDirection(DIR_RIGHT, passable);
+    BuildDirection(DIR_LEFT, passable);
+    BuildDirection(DIR_DOWN, passable);
+    BuildDirection(DIR_UP, passable);
+    if (corner_)
+    {
+        BuildDirection(DIR_RIGHT_DOWN, passable);
+        BuildDirection(DIR_RIGHT_UP, passable);
+        BuildDirection(DIR_LEFT_DOWN, passable);
+        BuildDirection(DIR_LEFT_UP, passable);
+    }
+}
+
+void JumpTable::BuildDirection(int dir, const std::vector<char> &passable)
+{
+    const int w = width_;
+    const int h = height_;
+    auto pass = [&](int x, int y) {
+        return x >= 0 && x < w && y >= 0 && y < h && passable[(size_t)y * w + x] != 0;
+    };
+    auto at = [&](int x, int y, int d) -> int16_t& {
+        return dist_[((size_t)y * w + x) * DIR_COUNT + d];
+    };
+
+    const int dx = kDirX[dir];
+    const int dy = kDirY[dir];
+    const bool diagonal = (dx != 0 && dy != 0);
+    const int hdir = diagonal ? GetDirection(dx, 0) : dir;
+    const int vdir = diagonal ? GetDirection(0, dy) : dir;
+
+    // 逆着前进方向遍历，保证下一格的值已经算好
+    for (int row = 0; row < h; ++row)
+    {
+        const int y = dy > 0 ? h - 1 - row : row;
+        for (int col = 0; col < w; ++col)
+        {
+            const int x = dx > 0 ? w - 1 - col : col;
+
+            // 不可通过的格子也要计算，单位可能站在上面作为起点；
+            // 其他格子的值只依赖能走进去的格子，不会用到这些值
+            int16_t &val = at(x, y, dir);
+            if (!CanStep(pass, x, y, dx, dy))
+            {
+                val = 0;
+                continue;
+            }
+
+            const int nx = x + dx;
+            const int ny = y + dy;
+            bool jumpPoint = false;
+            if (diagonal)
+            {
+                // 斜向前进时，任一分量方向上能找到跳点即为跳点
+                jumpPoint = at(nx, ny, hdir) > 0 || at(nx, ny, vdir) > 0;
+            }
+            else
+            {
+                jumpPoint = IsForced(pass, nx, ny, dx, dy);
+                if (!jumpPoint && !corner_ && dy != 0)
+                {
+                    // 4方向时竖直前进还要检查水平方向上的跳点
+                    jumpPoint = at(nx, ny, DIR_RIGHT) > 0 || at(nx, ny, DIR_LEFT) > 0;
+                }
+            }
+
+            if (jumpPoint)
+            {
+                val = 1;
+            }
+            else
+            {
+                const int next = at(nx, ny, dir);
+                const int cur = next > 0 ? next + 1 : next - 1;
+                val = (int16_t)(cur > kMaxJumpDist || cur < -kMaxJumpDist ? kMaxJumpDist : cur);
+            }
+        }
+    }
+}
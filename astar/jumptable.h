@@ -0,0 +1,101 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* JPS+ 预计算的跳跃距离表
+* 参考：Steve Rabin, JPS+: Over 100x Faster than A* (GDC 2015)
+*
+* 每个可通过的格子在每个方向上记录一个距离值：
+* 正数 n 表示沿该方向前进 n 格会遇到跳点；
+* 0 或负数 -n 表示沿该方向最多可以前进 n 格，之后是障碍或地图边界。
+*
+* 表只依赖地图的可通过性，与起点终点无关，地图变化后需要重新 Build。
+* 同一张表可被多个 AStar 实例只读共享。
+*/
+
+class JumpTable final
+{
+public:
+    /**
+     * 方向索引，前4个为正交方向，后4个为斜角方向
+     */
+    enum Direction
+    {
+        DIR_RIGHT,
+        DIR_LEFT,
+        DIR_DOWN,
+        DIR_UP,
+        DIR_RIGHT_DOWN,
+        DIR_RIGHT_UP,
+        DIR_LEFT_DOWN,
+        DIR_LEFT_UP,
+        DIR_COUNT,
+    };
+
+    static const int kDirX[DIR_COUNT];
+    static const int kDirY[DIR_COUNT];
+
+public:
+    JumpTable();
+    ~JumpTable();
+
+    /**
+     * 预计算整张地图的跳跃距离
+     * corner 必须和寻路时 Params::corner 一致
+     */
+    void Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass);
+
+    /**
+     * 表是否与地图参数匹配
+     */
+    bool Match(uint16_t width, uint16_t height, bool corner) const
+    {
+        return !dist_.empty() && width_ == width && height_ == height && corner_ == corner;
+    }
+
+    int16_t Get(const AStar::Vec2 &pos, int dir) const
+    {
+        return dist_[((size_t)pos.y * width_ + pos.x) * DIR_COUNT + dir];
+    }
+
+    static int GetDirection(int dx, int dy);
+
+    /**
+     * 从(x,y)向(dx,dy)走一步是否合法（斜角要求两侧正交格子均可通过）
+     */
+    template<typename PassFunc>
+    static bool CanStep(const PassFunc &pass, int x, int y, int dx, int dy)
+    {
+        if (!pass(x + dx, y + dy))
+        {
+            return false;
+        }
+        return (dx == 0 || dy == 0) || (pass(x + dx, y) && pass(x, y + dy));
+    }
+
+    /**
+     * 沿正交方向(dx,dy)进入(x,y)时是否存在强迫邻居
+     */
+    template<typename PassFunc>
+    static bool IsForced(const PassFunc &pass, int x, int y, int dx, int dy)
+    {
+        if (dx != 0)
+        {
+            return (pass(x, y - 1) && !pass(x - dx, y - 1))
+                || (pass(x, y + 1) && !pass(x - dx, y + 1));
+        }
+        return (pass(x - 1, y) && !pass(x - 1, y - dy))
+            || (pass(x + 1, y) && !pass(x + 1, y - dy));
+    }
+
+private:
+    void BuildDirection(int dir, const std::vector<char> &passable);
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    bool corner_;
+    std::vector<int16_t> dist_; // 按 (pos.y * width_ + pos.x) * DIR_COUNT + dir 存放
+};
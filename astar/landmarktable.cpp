@@ -0,0 +1,263 @@
+﻿#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <queue>
+#include "astar/landmarktable.h"
+
+static const int kStepVal = 10;
+static const int kObliqueVal = 14;
+
+// 文件格式：魔数、版本、宽、高、corner、地标数、地标坐标、距离表，按本机字节序存放
+static const char kFileMagic[4] = { 'V', 'T', 'W', 'L' };
+static const uint32_t kFileVersion = 1;
+
+const int LandmarkTable::kMaxLandmarks;
+const uint32_t LandmarkTable::kUnreachable;
+
+LandmarkTable::LandmarkTable() :
+    width_(0),
+    height_(0),
+    corner_(false)
+{
+}
+
+LandmarkTable::~LandmarkTable()
+{
+}
+
+void LandmarkTable::Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass, int landmarkCount)
+{
+    assert(landmarkCount > 0 && landmarkCount <= kMaxLandmarks);
+    if (landmarkCount > kMaxLandmarks)
+    {
+        landmarkCount = kMaxLandmarks;
+    }
+
+    width_ = width;
+    height_ = height;
+    corner_ = corner;
+    landmarks_.clear();
+    dist_.clear();
+
+    const size_t cellCount = (size_t)width_ * height_;
+    std::vector<char> passable(cellCount, 0);
+    size_t seed = cellCount;
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
+        {
+            const size_t index = (size_t)y * width_ + x;
+            passable[index] = canPass(AStar::Vec2(x, y)) ? 1 : 0;
+            if (passable[index] && seed == cellCount)
+            {
+                seed = index;
+            }
+        }
+    }
+
+    if (seed == cellCount)
+    {
+        return;
+    }
+
+    // 第一个地标取离任意一个可通过格子最远的格子，之后每次取离已选地标最远的格子
+    std::vector<uint32_t> dist;
+    std::vector<uint32_t> minDist(cellCount, kUnreachable);
+    CalcDistances(passable, AStar::Vec2((uint16_t)(seed % width_), (uint16_t)(seed / width_)), &minDist);
+
+    std::vector<std::vector<uint32_t>> rows;
+    while ((int)landmarks_.size() < landmarkCount)
+    {
+        size_t next = cellCount;
+        uint32_t farthest = 0;
+        for (size_t i = 0; i < cellCount; ++i)
+        {
+            // 与已选地标都不连通的格子不考虑，避免地标落在零散的小区域里
+            if (minDist[i] != kUnreachable && minDist[i] > farthest)
+            {
+                farthest = minDist[i];
+                next = i;
+            }
+        }
+
+        if (next == cellCount)
+        {
+            break;
+        }
+
+        const AStar::Vec2 landmark((uint16_t)(next % width_), (uint16_t)(next / width_));
+        landmarks_.push_back(landmark);
+        CalcDistances(passable, landmark, &dist);
+
+        rows.push_back(dist);
+        for (size_t i = 0; i < cellCount; ++i)
+        {
+            if (landmarks_.size() == 1 || dist[i] < minDist[i])
+            {
+                minDist[i] = dist[i];
+            }
+        }
+    }
+
+    // 同一格子到各个地标的距离相邻存放，估价时只读一段连续内存
+    const size_t count = landmarks_.size();
+    dist_.resize(cellCount * count);
+    for (size_t i = 0; i < cellCount; ++i)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            dist_[i * count + k] = rows[k][i];
+        }
+    }
+}
+
+// 从 from 出发的 Dijkstra，移动规则与 AStar 一致，不可达的格子为 kUnreachable
+void LandmarkTable::CalcDistances(const std::vector<char> &passable, const AStar::Vec2 &from, std::vector<uint32_t> *outDist) const
+{
+    const int w = width_;
+    const int h = height_;
+    auto pass = [&](int x, int y) {
+        return x >= 0 && x < w && y >= 0 && y < h && passable[(size_t)y * w + x] != 0;
+    };
+
+    std::vector<uint32_t> &dist = *outDist;
+    dist.assign((size_t)w * h, kUnreachable);
+
+    using OpenItem = std::pair<uint32_t, uint32_t>; // g, index
+    std::priority_queue<OpenItem, std::vector<OpenItem>, std::greater<OpenItem>> openList;
+    const uint32_t fromIndex = (uint32_t)from.y * w + from.x;
+    dist[fromIndex] = 0;
+    openList.push(OpenItem(0, fromIndex));
+
+    while (!openList.empty())
+    {
+        const OpenItem item = openList.top();
+        openList.pop();
+        if (item.first > dist[item.second])
+        {
+            continue;
+        }
+
+        const int x = item.second % w;
+        const int y = item.second / w;
+        for (int dy = -1; dy <= 1; ++dy)
+        {
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if ((dx == 0 && dy == 0) || !pass(x + dx, y + dy))
+                {
+                    continue;
+                }
+
+                uint32_t cost = kStepVal;
+                if (dx != 0 && dy != 0)
+                {
+                    if (!corner_ || !pass(x + dx, y) || !pass(x, y + dy))
+                    {
+                        continue;
+                    }
+                    cost = kObliqueVal;
+                }
+
+                const uint32_t index = (uint32_t)(y + dy) * w + (x + dx);
+                if (item.first + cost < dist[index])
+                {
+                    dist[index] = item.first + cost;
+                    openList.push(OpenItem(dist[index], index));
+                }
+            }
+        }
+    }
+}
+
+bool LandmarkTable::Save(const std::string &filename) const
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const uint8_t corner = corner_ ? 1 : 0;
+    const uint8_t count = (uint8_t)landmarks_.size();
+    bool ok = fwrite(kFileMagic, sizeof(kFileMagic), 1, file) == 1
+        && fwrite(&kFileVersion, sizeof(kFileVersion), 1, file) == 1
+        && fwrite(&width_, sizeof(width_), 1, file) == 1
+        && fwrite(&height_, sizeof(height_), 1, file) == 1
+        && fwrite(&corner, sizeof(corner), 1, file) == 1
+        && fwrite(&count, sizeof(count), 1, file) == 1;
+
+    for (size_t i = 0; ok && i < landmarks_.size(); ++i)
+    {
+        ok = fwrite(&landmarks_[i].x, sizeof(uint16_t), 1, file) == 1
+            && fwrite(&landmarks_[i].y, sizeof(uint16_t), 1, file) == 1;
+    }
+
+    if (ok && !dist_.empty())
+    {
+        ok = fwrite(dist_.data(), sizeof(uint32_t), dist_.size(), file) == dist_.size();
+    }
+
+    return fclose(file) == 0 && ok;
+}
+
+bool LandmarkTable::Load(const std::string &filename)
+{
+    width_ = 0;
+    height_ = 0;
+    corner_ = false;
+    landmarks_.clear();
+    dist_.clear();
+
+    FILE *file = fopen(filename.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t version = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint8_t corner = 0;
+    uint8_t count = 0;
+    bool ok = fread(magic, sizeof(magic), 1, file) == 1
+        && fread(&version, sizeof(version), 1, file) == 1
+        && fread(&width, sizeof(width), 1, file) == 1
+        && fread(&height, sizeof(height), 1, file) == 1
+        && fread(&corner, sizeof(corner), 1, file) == 1
+        && fread(&count, sizeof(count), 1, file) == 1
+        && memcmp(magic, kFileMagic, sizeof(magic)) == 0
+        && version == kFileVersion
+        && count <= kMaxLandmarks;
+
+    std::vector<AStar::Vec2> landmarks(ok ? count : 0);
+    for (size_t i = 0; ok && i < landmarks.size(); ++i)
+    {
+        ok = fread(&landmarks[i].x, sizeof(uint16_t), 1, file) == 1
+            && fread(&landmarks[i].y, sizeof(uint16_t), 1, file) == 1
+            && landmarks[i].x < width && landmarks[i].y < height;
+    }
+
+    std::vector<uint32_t> dist(ok ? (size_t)width * height * count : 0);
+    if (ok && !dist.empty())
+    {
+        ok = fread(dist.data(), sizeof(uint32_t), dist.size(), file) == dist.size();
+    }
+
+    // 文件应恰好在距离表之后结束
+    ok = ok && fgetc(file) == EOF;
+    fclose(file);
+    if (!ok)
+    {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    corner_ = corner != 0;
+    landmarks_.swap(landmarks);
+    dist_.swap(dist);
+    return true;
+}
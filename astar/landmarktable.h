@@ -0,0 +1,92 @@
+﻿#pragma once
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* ALT（A*, Landmarks, Triangle inequality）估价函数的地标距离表
+* 参考：Goldberg & Harrelson, Computing the Shortest Path: A* Search Meets Graph Theory (SODA 2005)
+*
+* 预先选出 K 个地标格子，记录每个格子到每个地标的精确距离。
+* 由三角不等式，|d(L,a) - d(L,b)| 不大于 a 到 b 的距离，取所有地标中的最大值作为估价，
+* 迷宫类地图上远比曼哈顿距离准确，A星不再退化为接近 Dijkstra 的扩展范围。
+*
+* 地标按最远点选取：每次选与已选地标距离最近值最大的格子，尽量分布在地图边缘。
+* 距离与 AStar 的代价一致（正交10，斜角14），按 uint32_t 存放，任意尺寸的地图上都不会截断。
+* 表的大小为 格子数 x 地标数 x 4 字节，1024x1024 的地图使用 8 个地标时为 32MB，
+* 适合一百万格左右以内的地图；更大的地图应减少地标数或只对关键区域建表。
+*
+* 表只依赖地图的可通过性和 corner，地图变化后需要重新 Build。
+* 可以 Save 到文件，服务器启动时 Load，不必每次重新计算。
+* 同一张表可被多个 AStar 实例只读共享。
+*/
+
+class LandmarkTable final
+{
+public:
+    static const int kMaxLandmarks = 32;
+    static const uint32_t kUnreachable = UINT32_MAX;
+
+public:
+    LandmarkTable();
+    ~LandmarkTable();
+
+    /**
+     * 选出 landmarkCount 个地标并计算距离
+     * corner 必须和寻路时 Params::corner 一致
+     */
+    void Build(uint16_t width, uint16_t height, bool corner, const AStar::CanPassFunc &canPass, int landmarkCount = 8);
+
+    /**
+     * 保存到文件 / 从文件读取，失败返回 false，读取失败时表为空
+     */
+    bool Save(const std::string &filename) const;
+    bool Load(const std::string &filename);
+
+    /**
+     * 表是否与地图参数匹配
+     */
+    bool Match(uint16_t width, uint16_t height, bool corner) const
+    {
+        return width_ != 0 && width_ == width && height_ == height && corner_ == corner;
+    }
+
+    int GetLandmarkCount() const { return (int)landmarks_.size(); }
+    const AStar::Vec2& GetLandmark(int index) const { return landmarks_[index]; }
+
+    /**
+     * pos 到 end 的距离下界，pos 或 end 不可通过时没有约束，返回 0
+     */
+    uint32_t Calc(const AStar::Vec2 &pos, const AStar::Vec2 &end) const
+    {
+        const size_t count = landmarks_.size();
+        const uint32_t *from = dist_.data() + ((size_t)pos.y * width_ + pos.x) * count;
+        const uint32_t *to = dist_.data() + ((size_t)end.y * width_ + end.x) * count;
+        uint32_t h = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (from[i] == kUnreachable || to[i] == kUnreachable)
+            {
+                continue;
+            }
+
+            const uint32_t d = from[i] > to[i] ? from[i] - to[i] : to[i] - from[i];
+            if (d > h)
+            {
+                h = d;
+            }
+        }
+        return h;
+    }
+
+private:
+    void CalcDistances(const std::vector<char> &passable, const AStar::Vec2 &from, std::vector<uint32_t> *outDist) const;
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    bool corner_;
+    std::vector<AStar::Vec2> landmarks_;
+    std::vector<uint32_t> dist_; // 按 (pos.y * width_ + pos.x) * 地标数 + 地标序号 存放，同一格子的距离相邻
+};
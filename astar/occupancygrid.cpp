@@ -0,0 +1,43 @@
+﻿#include <assert.h>
+#include "astar/occupancygrid.h"
+
+OccupancyGrid::OccupancyGrid() :
+    width_(0),
+    height_(0),
+    stride_(0)
+{
+}
+
+OccupancyGrid::~OccupancyGrid()
+{
+}
+
+void OccupancyGrid::Reset(uint16_t width, uint16_t height)
+{
+    width_ = width;
+    height_ = height;
+    stride_ = ((size_t)width_ + 2 + 63) / 64;
+
+    const size_t count = stride_ * ((size_t)height_ + 2);
+    words_.reset(new std::atomic<uint64_t>[count]);
+    for (size_t i = 0; i < count; ++i)
+    {
+        words_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void OccupancyGrid::Set(int x, int y, bool occupied)
+{
+    assert(x >= 0 && x < width_ && y >= 0 && y < height_);
+
+    const size_t bit = (size_t)(y + 1) * stride_ * 64 + x + 1;
+    const uint64_t mask = (uint64_t)1 << (bit & 63);
+    if (occupied)
+    {
+        words_[bit >> 6].fetch_or(mask, std::memory_order_relaxed);
+    }
+    else
+    {
+        words_[bit >> 6].fetch_and(~mask, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include "astar/astar.h"
+
+/**
+* 动态占用层：记录哪些格子被单位占据，每个格子占 1 bit
+*
+* 与静态地图（canPass / passGrid / costGrid）分开存放，单位移动只修改这一层，
+* RegionIndex、LandmarkTable 等按静态地图预计算的结构不需要重建。
+* JumpTable 的跳跃距离没有考虑占据的格子，因此不能与 SEARCH_JPS_PLUS 同时使用。
+*
+* 设置到 AStar::Params::occupancy 后被占据的格子不可通过，起点、终点和 goals 中的格子除外。
+* occupancyRadius 不为 0 时只考虑与起点横向和纵向距离都不超过它的格子，远处的单位到时通常已经离开。
+*
+* 每个 64 位字都是原子变量，Set 使用原子的或/与操作，
+* 多个线程可以同时更新不同的格子，寻路线程也可以同时读取，不需要加锁。
+* 读写都不保证顺序，寻路过程中发生的移动可能只被部分看到。
+*
+* 同一格子只记录是否被占据，多个单位叠在同一格子时需要调用方自己计数。
+* 布局与 BitGrid 相同：每行按 64 位字对齐，四周留一圈不被占据的哨兵格子。
+*/
+
+class OccupancyGrid final
+{
+public:
+    OccupancyGrid();
+    ~OccupancyGrid();
+
+    /**
+     * 重置为 width*height 的网格，所有格子都不被占据
+     * 不能与 Set 或寻路同时调用
+     */
+    void Reset(uint16_t width, uint16_t height);
+
+    uint16_t GetWidth() const { return width_; }
+    uint16_t GetHeight() const { return height_; }
+
+    bool Get(int x, int y) const
+    {
+        if (x < 0 || x >= width_ || y < 0 || y >= height_)
+        {
+            return false;
+        }
+        const size_t bit = (size_t)(y + 1) * stride_ * 64 + x + 1;
+        return ((words_[bit >> 6].load(std::memory_order_relaxed) >> (bit & 63)) & 1) != 0;
+    }
+
+    void Set(int x, int y, bool occupied);
+
+    /**
+     * 单位从 from 移动到 to
+     */
+    void Move(const AStar::Vec2 &from, const AStar::Vec2 &to)
+    {
+        Set(from.x, from.y, false);
+        Set(to.x, to.y, true);
+    }
+
+    /**
+     * 读取(x,y)的 3x3 邻域，第 (dy+1)*3+(dx+1) 位表示(x+dx,y+dy)是否被占据
+     */
+    uint32_t GetNeighborhood(int x, int y) const
+    {
+        return Read3(y, x) | (Read3(y + 1, x) << 3) | (Read3(y + 2, x) << 6);
+    }
+
+private:
+    uint32_t Read3(int row, int col) const
+    {
+        const std::atomic<uint64_t> *p = &words_[(size_t)row * stride_ + (col >> 6)];
+        const unsigned shift = col & 63;
+        uint64_t bits = p[0].load(std::memory_order_relaxed) >> shift;
+        if (shift > 61)
+        {
+            bits |= p[1].load(std::memory_order_relaxed) << (64 - shift);
+        }
+        return (uint32_t)(bits & 7);
+    }
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    size_t stride_; // 每行（含哨兵）占用的 64 位字数
+    std::unique_ptr<std::atomic<uint64_t>[]> words_;
+};
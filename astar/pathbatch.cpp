@@ -0,0 +1,84 @@
+﻿#include <assert.h>
+#include "astar/pathbatch.h"
+#include "base/countdownlatch.h"
+#include "base/threadpool.h"
+
+// 每次领取的请求数，减少对领取位置的争用，同时保持负载均衡
+static const size_t kChunkSize = 8;
+
+PathBatch::PathBatch(vtw::ThreadPool &pool, size_t threadNum) :
+    pool_(pool),
+    contexts_(threadNum + 1)
+{
+}
+
+PathBatch::~PathBatch()
+{
+}
+
+void PathBatch::FindBatch(const AStar::Params &param, const Query *queries, Result *results, size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // ChunkedGrid 读取时会加载和淘汰块，不能被多个线程同时使用
+    if (param.chunkGrid)
+    {
+        assert(false);
+        return;
+    }
+
+    // 请求较少时不需要用到所有线程；线程池已停止时提交的任务不会执行，全部在调用线程中完成
+    const size_t chunkCount = (count + kChunkSize - 1) / kChunkSize;
+    size_t taskNum = chunkCount < contexts_.size() ? chunkCount : contexts_.size();
+    if (pool_.IsStopped())
+    {
+        taskNum = 1;
+    }
+
+    // 领取位置属于这一批请求，返回前所有任务都已结束，放在栈上即可
+    std::lock_guard<std::mutex> guard(mutex_);
+    std::atomic<size_t> next(0);
+    vtw::CountDownLatch latch((int)taskNum - 1);
+    for (size_t i = 0; i + 1 < taskNum; ++i)
+    {
+        AStar *context = &contexts_[i];
+        pool_.AddTask([context, &next, &param, queries, results, count, &latch] {
+            __FindRange(*context, next, param, queries, results, count);
+            latch.CountDown();
+        });
+    }
+
+    __FindRange(contexts_.back(), next, param, queries, results, count);
+    latch.Wait();
+}
+
+void PathBatch::FindBatch(const AStar::Params &param, const std::vector<Query> &queries, std::vector<Result> *results)
+{
+    results->resize(queries.size());
+    FindBatch(param, queries.data(), results->data(), queries.size());
+}
+
+void PathBatch::__FindRange(AStar &context, std::atomic<size_t> &next, const AStar::Params &param, const Query *queries, Result *results, size_t count)
+{
+    // 每个线程复制一份参数，避免逐个请求复制 canPass
+    AStar::Params local = param;
+    for (;;)
+    {
+        const size_t begin = next.fetch_add(kChunkSize);
+        if (begin >= count)
+        {
+            break;
+        }
+
+        const size_t end = begin + kChunkSize < count ? begin + kChunkSize : count;
+        for (size_t i = begin; i < end; ++i)
+        {
+            local.start = queries[i].start;
+            local.end = queries[i].end;
+            results[i] = context.Find(local);
+        }
+    }
+}
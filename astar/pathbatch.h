@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "astar/astar.h"
+
+namespace vtw
+{
+class ThreadPool;
+}
+
+/**
+* 批量寻路
+*
+* 把一批互不相关的寻路请求分给 vtw::ThreadPool 的线程并行执行，调用线程也参与计算。
+* 每个线程使用独立的 AStar 作为搜索上下文，地图（canPass / passGrid / jumpTable）在线程间共享，
+* 因此寻路期间地图必须只读，canPass 必须可以被多个线程同时调用。
+* 结果按请求顺序写入，与逐个调用 AStar::Find 得到的路径相同。
+*
+* 不要在线程池的线程中调用 FindBatch，否则可能等不到空闲线程。
+* 线程池停止后所有请求都在调用线程中执行，但不能在 FindBatch 执行期间停止线程池。
+* 多个线程同时调用同一个 PathBatch 的 FindBatch 时按顺序执行，各批请求互不影响。
+*/
+
+class PathBatch final
+{
+public:
+    /**
+     * 寻路请求，其余参数在整批请求之间共享
+     */
+    struct Query
+    {
+        AStar::Vec2 start;
+        AStar::Vec2 end;
+    };
+
+    using Result = std::vector<AStar::Vec2>;
+
+public:
+    /**
+     * threadNum 为 pool 中的线程数，pool 的生命周期必须长于 PathBatch
+     */
+    PathBatch(vtw::ThreadPool &pool, size_t threadNum);
+    ~PathBatch();
+
+    /**
+     * 并行执行 count 个请求，results[i] 对应 queries[i]
+     * param 中的 start 和 end 被忽略
+     * 返回时所有请求都已完成；param 不能设置 chunkGrid，否则不执行任何请求
+     */
+    void FindBatch(const AStar::Params &param, const Query *queries, Result *results, size_t count);
+
+    void FindBatch(const AStar::Params &param, const std::vector<Query> &queries, std::vector<Result> *results);
+
+private:
+    static void __FindRange(AStar &context, std::atomic<size_t> &next, const AStar::Params &param, const Query *queries, Result *results, size_t count);
+
+private:
+    vtw::ThreadPool &pool_;
+    std::mutex mutex_; // 一次只执行一批请求，搜索上下文不能被两批请求同时使用
+    std::vector<AStar> contexts_; // 每个线程一个搜索上下文，最后一个给调用线程使用
+};
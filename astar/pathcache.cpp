@@ -0,0 +1,159 @@
+﻿#include <assert.h>
+#include <algorithm>
+#include "astar/pathcache.h"
+
+size_t PathCache::KeyHash::operator()(const Key &key) const
+{
+    uint64_t h = key.pos ^ ((uint64_t)key.version << 1) ^ (uint64_t)key.corner;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
+PathCache::PathCache(size_t capacity) :
+    capacity_(capacity),
+    version_(0),
+    hits_(0),
+    misses_(0),
+    memory_(0)
+{
+    assert(capacity > 0);
+    lookup_.reserve(capacity);
+}
+
+PathCache::~PathCache()
+{
+}
+
+// 链表节点、哈希节点和路径数组的大致大小
+size_t PathCache::__GetEntrySize(const Entry &entry)
+{
+    const size_t listNode = sizeof(Entry) + sizeof(void*) * 2;
+    const size_t hashNode = sizeof(Key) + sizeof(EntryList::iterator) + sizeof(void*) * 2;
+    return listNode + hashNode + entry.path.capacity() * sizeof(AStar::Vec2);
+}
+
+void PathCache::Erase(EntryList::iterator it)
+{
+    memory_ -= __GetEntrySize(*it);
+    lookup_.erase(it->key);
+    entries_.erase(it);
+}
+
+std::vector<AStar::Vec2> PathCache::Find(AStar &astar, const AStar::Params &param)
+{
+    if (param.goals)
+    {
+        return astar.Find(param);
+    }
+
+    Key key;
+    key.pos = ((uint64_t)param.start.x << 48) | ((uint64_t)param.start.y << 32) | ((uint64_t)param.end.x << 16) | param.end.y;
+    key.version = version_;
+    key.corner = param.corner;
+
+    auto found = lookup_.find(key);
+    if (found != lookup_.end())
+    {
+        ++hits_;
+        entries_.splice(entries_.begin(), entries_, found->second);
+        return found->second->path;
+    }
+    ++misses_;
+
+    std::vector<AStar::Vec2> path = astar.Find(param);
+    if (path.empty() || !(path.back() == param.end))
+    {
+        return path;
+    }
+
+    if (entries_.size() >= capacity_)
+    {
+        Erase(std::prev(entries_.end()));
+    }
+
+    entries_.emplace_front();
+    Entry &entry = entries_.front();
+    entry.key = key;
+    entry.path = path;
+    entry.min = param.start;
+    entry.max = param.start;
+    for (const auto &pos : path)
+    {
+        entry.min.x = std::min(entry.min.x, pos.x);
+        entry.min.y = std::min(entry.min.y, pos.y);
+        entry.max.x = std::max(entry.max.x, pos.x);
+        entry.max.y = std::max(entry.max.y, pos.y);
+    }
+    lookup_[key] = entries_.begin();
+    memory_ += __GetEntrySize(entry);
+    return path;
+}
+
+size_t PathCache::Invalidate(const std::vector<AStar::Vec2> &changedCells)
+{
+    if (changedCells.empty())
+    {
+        return 0;
+    }
+
+    // 先和所有变化格子的外接矩形比较，大部分路径不需要逐个格子检查
+    AStar::Vec2 min = changedCells.front();
+    AStar::Vec2 max = changedCells.front();
+    for (const auto &cell : changedCells)
+    {
+        min.x = std::min(min.x, cell.x);
+        min.y = std::min(min.y, cell.y);
+        max.x = std::max(max.x, cell.x);
+        max.y = std::max(max.y, cell.y);
+    }
+
+    size_t count = 0;
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+        const Entry &entry = *it;
+        bool affected = false;
+        if (entry.min.x <= max.x && min.x <= entry.max.x && entry.min.y <= max.y && min.y <= entry.max.y)
+        {
+            for (const auto &cell : changedCells)
+            {
+                if (cell.x >= entry.min.x && cell.x <= entry.max.x && cell.y >= entry.min.y && cell.y <= entry.max.y)
+                {
+                    affected = true;
+                    break;
+                }
+            }
+        }
+
+        if (affected)
+        {
+            Erase(it++);
+            ++count;
+        }
+        else
+        {
+            ++it;
+        }
+    }
+    return count;
+}
+
+void PathCache::Clear()
+{
+    entries_.clear();
+    lookup_.clear();
+    memory_ = 0;
+}
+
+double PathCache::GetHitRate() const
+{
+    const uint64_t total = hits_ + misses_;
+    return total > 0 ? (double)hits_ / total : 0.0;
+}
+
+void PathCache::ResetStats()
+{
+    hits_ = 0;
+    misses_ = 0;
+}
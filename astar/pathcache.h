@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 寻路结果缓存
+*
+* 放在 AStar::Find 前面，按 (start, end, corner, 地图版本) 缓存完整路径，容量满时淘汰最久未使用的路径。
+* 巡逻路线、城镇到副本等起终点固定的请求命中后不再搜索。
+*
+* 地图变化时有两种失效方式：
+* Invalidate 传入变化的格子，删除包围盒（起点和所有路径点的外接矩形）包含这些格子的路径；
+* 大范围变化时调用 SetMapVersion 换一个版本，旧版本的路径不再命中，随后被 LRU 淘汰。
+* 包围盒以外的格子变为可通过时可能出现更短的路径，缓存的路径仍然可以走通，需要最优路径时应换版本。
+*
+* 一个缓存只对应一份地图和一组搜索参数，除 start、end、corner 外的参数在请求之间必须相同。
+* 没有找到的路径和部分路径不缓存，设置了 goals 的请求直接调用 AStar::Find。
+*/
+
+class PathCache final
+{
+public:
+    explicit PathCache(size_t capacity);
+    ~PathCache();
+
+    /**
+     * 命中时返回缓存的路径，否则调用 astar.Find 并缓存找到的路径
+     */
+    std::vector<AStar::Vec2> Find(AStar &astar, const AStar::Params &param);
+
+    /**
+     * 设置地图版本，之后只命中同一版本下缓存的路径
+     */
+    void SetMapVersion(uint32_t version) { version_ = version; }
+    uint32_t GetMapVersion() const { return version_; }
+
+    /**
+     * 地图格子变化后删除可能受影响的路径，返回删除的路径数
+     */
+    size_t Invalidate(const std::vector<AStar::Vec2> &changedCells);
+
+    void Clear();
+
+    size_t GetSize() const { return entries_.size(); }
+    size_t GetCapacity() const { return capacity_; }
+
+    /**
+     * 命中统计，用于调整容量
+     */
+    uint64_t GetHitCount() const { return hits_; }
+    uint64_t GetMissCount() const { return misses_; }
+    double GetHitRate() const;
+    void ResetStats();
+
+    /**
+     * 缓存占用内存的估计值（字节），包括路径和索引节点
+     */
+    size_t GetMemoryUsage() const { return memory_; }
+
+private:
+    struct Key
+    {
+        uint64_t pos; // 起点和终点
+        uint32_t version;
+        bool corner;
+
+        bool operator==(const Key &o) const
+        {
+            return pos == o.pos && version == o.version && corner == o.corner;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const;
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::vector<AStar::Vec2> path;
+        AStar::Vec2 min; // 包围盒
+        AStar::Vec2 max;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static size_t __GetEntrySize(const Entry &entry);
+    void Erase(EntryList::iterator it);
+
+private:
+    size_t capacity_;
+    uint32_t version_;
+    EntryList entries_; // 表头是最近使用的路径
+    std::unordered_map<Key, EntryList::iterator, KeyHash> lookup_;
+    uint64_t hits_;
+    uint64_t misses_;
+    size_t memory_;
+};
@@ -0,0 +1,112 @@
+﻿#include "astar/pathscheduler.h"
+
+PathScheduler::PathScheduler(size_t frameBudget) :
+    frameBudget_(frameBudget),
+    nextId_(0),
+    cursor_(0)
+{
+}
+
+PathScheduler::~PathScheduler()
+{
+}
+
+std::unique_ptr<ResumableAStar> PathScheduler::AcquireSearch()
+{
+    if (idleSearches_.empty())
+    {
+        return std::unique_ptr<ResumableAStar>(new ResumableAStar());
+    }
+
+    std::unique_ptr<ResumableAStar> search = std::move(idleSearches_.back());
+    idleSearches_.pop_back();
+    return search;
+}
+
+void PathScheduler::ReleaseSearch(std::unique_ptr<ResumableAStar> search)
+{
+    idleSearches_.push_back(std::move(search));
+}
+
+uint32_t PathScheduler::Add(const AStar::Params &param, const Callback &callback)
+{
+    std::unique_ptr<Query> query(new Query());
+    query->search = AcquireSearch();
+    if (!query->search->Start(param))
+    {
+        ReleaseSearch(std::move(query->search));
+        return 0;
+    }
+
+    // 跳过 0，0 表示无效 id
+    if (++nextId_ == 0)
+    {
+        ++nextId_;
+    }
+    query->id = nextId_;
+    query->callback = callback;
+    queries_.push_back(std::move(query));
+    return nextId_;
+}
+
+bool PathScheduler::Cancel(uint32_t id)
+{
+    for (size_t i = 0; i < queries_.size(); ++i)
+    {
+        if (queries_[i]->id == id)
+        {
+            ReleaseSearch(std::move(queries_[i]->search));
+            queries_.erase(queries_.begin() + i);
+            if (i < cursor_)
+            {
+                --cursor_;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void PathScheduler::Update()
+{
+    size_t budget = frameBudget_;
+    while (budget > 0 && !queries_.empty())
+    {
+        // 平分剩余预算，请求太多时每个请求至少扩展 kMinSlice 个节点，剩下的请求留到下一帧
+        size_t share = budget / queries_.size();
+        if (share < kMinSlice)
+        {
+            share = kMinSlice;
+        }
+
+        for (size_t turns = queries_.size(); turns > 0 && budget > 0 && !queries_.empty(); --turns)
+        {
+            if (cursor_ >= queries_.size())
+            {
+                cursor_ = 0;
+            }
+
+            Query &query = *queries_[cursor_];
+            const size_t slice = share < budget ? share : budget;
+            const size_t before = query.search->GetExpandedCount();
+            const AStar::StepResult result = query.search->Step(slice);
+            const size_t used = query.search->GetExpandedCount() - before;
+            budget -= used < budget ? used : budget;
+
+            if (result == AStar::STEP_PENDING)
+            {
+                ++cursor_;
+                continue;
+            }
+
+            // 先移出再回调，回调中可以安全地 Add 或 Cancel，回调结束后才归还上下文
+            std::unique_ptr<Query> done = std::move(queries_[cursor_]);
+            queries_.erase(queries_.begin() + cursor_);
+            if (done->callback)
+            {
+                done->callback(result, done->search->GetPath());
+            }
+            ReleaseSearch(std::move(done->search));
+        }
+    }
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "astar/resumableastar.h"
+
+/**
+* 分帧寻路调度
+*
+* 每帧调用一次 Update，在所有未完成的寻路之间轮流分配固定的节点扩展预算，
+* 单帧寻路耗时有上限，长距离寻路不会阻塞其他请求。
+* 每次轮到的请求最多扩展 预算/请求数 个节点（不少于 kMinSlice），
+* 预算用完时记录下一次从哪个请求开始，跨帧保持公平。
+*
+* 搜索上下文（节点数组和开启列表）在请求之间复用：完成或取消的请求把上下文放回空闲列表，
+* 新请求优先取空闲的上下文，上下文数只等于同时进行的请求数的峰值，
+* 地图尺寸不变时添加请求不再分配和填充节点数组。
+*/
+
+class PathScheduler final
+{
+public:
+    /**
+     * 寻路结束时的回调，result 为 STEP_FOUND、STEP_PARTIAL 或 STEP_FAILED
+     */
+    using Callback = std::function<void(AStar::StepResult result, const std::vector<AStar::Vec2> &path)>;
+
+    static const size_t kMinSlice = 16; // 每次轮到时最少扩展的节点数
+
+public:
+    explicit PathScheduler(size_t frameBudget);
+    ~PathScheduler();
+
+    /**
+     * 添加寻路请求，返回请求 id，参数错误时返回 0 且不会回调
+     */
+    uint32_t Add(const AStar::Params &param, const Callback &callback);
+
+    /**
+     * 取消未完成的请求，不会回调
+     */
+    bool Cancel(uint32_t id);
+
+    /**
+     * 执行一帧的寻路，完成的请求在这里回调
+     */
+    void Update();
+
+    size_t GetPendingCount() const { return queries_.size(); }
+
+    size_t GetFrameBudget() const { return frameBudget_; }
+    void SetFrameBudget(size_t frameBudget) { frameBudget_ = frameBudget; }
+
+private:
+    struct Query
+    {
+        uint32_t id;
+        std::unique_ptr<ResumableAStar> search;
+        Callback callback;
+    };
+
+private:
+    std::unique_ptr<ResumableAStar> AcquireSearch();
+    void ReleaseSearch(std::unique_ptr<ResumableAStar> search);
+
+private:
+    size_t frameBudget_; // 每帧扩展的节点总数
+    uint32_t nextId_;
+    size_t cursor_; // 下一个轮到的请求
+    std::vector<std::unique_ptr<Query>> queries_; // 按加入顺序排列的未完成请求
+    std::vector<std::unique_ptr<ResumableAStar>> idleSearches_; // 空闲的搜索上下文
+};
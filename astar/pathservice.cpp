@@ -0,0 +1,249 @@
+﻿#include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include "astar/pathservice.h"
+#include "astar/resumableastar.h"
+#include "base/lockedqueue.h"
+#include "base/threadpool.h"
+
+// 每次连续扩展的节点数，之间检查请求是否已取消
+static const size_t kSliceSize = 4096;
+
+// 一次寻路计算，可能对应多个起点和终点相同的请求
+struct PathService::Job
+{
+    AStar::Vec2 start;
+    AStar::Vec2 end;
+    std::atomic<bool> cancelled; // 所有请求都已取消，尚未开始时跳过计算
+    AStar::StepResult result;
+    std::vector<AStar::Vec2> path;
+    std::vector<uint32_t> waiters; // 等待结果的请求 id，只在逻辑线程中访问
+
+    Job(const AStar::Vec2 &start, const AStar::Vec2 &end)
+        : start(start), end(end), cancelled(false), result(AStar::STEP_FAILED)
+    {
+    }
+};
+
+// 每个线程使用的搜索上下文，参数只复制一次
+struct PathService::Context
+{
+    ResumableAStar search;
+    AStar::Params param;
+};
+
+struct PathService::State
+{
+    vtw::LockedQueue<std::shared_ptr<Job>> pending; // 等待计算
+    vtw::LockedQueue<std::shared_ptr<Job>> done; // 计算完成，等待 Dispatch
+
+    AStar::Params param; // 新建上下文时复制的参数
+
+    std::mutex mutex; // 保护下面的成员
+    std::condition_variable idle;
+    std::vector<std::unique_ptr<Context>> contexts; // 空闲的搜索上下文
+    size_t running; // 正在计算的任务数
+    std::atomic<bool> closed; // PathService 已析构，之后开始的任务直接返回，正在计算的任务尽快结束
+};
+
+PathService::PathService(vtw::ThreadPool &pool, size_t threadNum, const AStar::Params &param) :
+    pool_(pool),
+    width_(param.width),
+    height_(param.height),
+    state_(std::make_shared<State>()),
+    nextId_(0)
+{
+    // 预先为每个线程创建一个上下文，不够时在任务中再创建
+    state_->param = param;
+    for (size_t i = 0; i < threadNum; ++i)
+    {
+        std::unique_ptr<Context> context(new Context());
+        context->param = param;
+        state_->contexts.push_back(std::move(context));
+    }
+    state_->running = 0;
+    state_->closed = false;
+}
+
+PathService::~PathService()
+{
+    for (auto &pair : inFlight_)
+    {
+        pair.second->cancelled = true;
+    }
+
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->closed = true;
+    state_->idle.wait(lock, [this] { return state_->running == 0; });
+}
+
+uint64_t PathService::__MakeKey(const AStar::Vec2 &start, const AStar::Vec2 &end)
+{
+    return ((uint64_t)start.x << 48) | ((uint64_t)start.y << 32) | ((uint64_t)end.x << 16) | end.y;
+}
+
+uint32_t PathService::Request(const AStar::Vec2 &start, const AStar::Vec2 &end, const Callback &callback)
+{
+    if (start.x >= width_ || start.y >= height_ || end.x >= width_ || end.y >= height_)
+    {
+        assert(false);
+        return 0;
+    }
+
+    // ChunkedGrid 读取时会加载和淘汰块，不能被多个线程同时使用
+    if (state_->param.chunkGrid)
+    {
+        assert(false);
+        return 0;
+    }
+
+    // 线程池停止后不会再执行任务，请求永远等不到回调
+    if (pool_.IsStopped())
+    {
+        assert(false);
+        return 0;
+    }
+
+    // 跳过 0，0 表示无效 id
+    if (++nextId_ == 0)
+    {
+        ++nextId_;
+    }
+
+    // 相同起点和终点的计算还未完成时直接等它的结果
+    std::shared_ptr<Job> &job = inFlight_[__MakeKey(start, end)];
+    if (!job)
+    {
+        job = std::make_shared<Job>(start, end);
+        state_->pending.Put(job);
+        std::shared_ptr<State> state = state_;
+        pool_.AddTask([state] { __Run(state); });
+    }
+    job->waiters.push_back(nextId_);
+
+    PendingRequest &request = requests_[nextId_];
+    request.job = job;
+    request.callback = callback;
+    return nextId_;
+}
+
+bool PathService::Cancel(uint32_t id)
+{
+    auto it = requests_.find(id);
+    if (it == requests_.end())
+    {
+        return false;
+    }
+
+    std::shared_ptr<Job> job = std::move(it->second.job);
+    requests_.erase(it);
+
+    std::vector<uint32_t> &waiters = job->waiters;
+    waiters.erase(std::remove(waiters.begin(), waiters.end(), id), waiters.end());
+    if (waiters.empty())
+    {
+        // 之后相同的请求重新计算
+        job->cancelled = true;
+        auto jobIt = inFlight_.find(__MakeKey(job->start, job->end));
+        if (jobIt != inFlight_.end() && jobIt->second == job)
+        {
+            inFlight_.erase(jobIt);
+        }
+    }
+    return true;
+}
+
+size_t PathService::Dispatch()
+{
+    size_t count = 0;
+    std::shared_ptr<Job> job;
+    while (state_->done.TryTake(job))
+    {
+        auto jobIt = inFlight_.find(__MakeKey(job->start, job->end));
+        if (jobIt != inFlight_.end() && jobIt->second == job)
+        {
+            inFlight_.erase(jobIt);
+        }
+
+        // 先取出等待的请求再回调，回调中可以安全地 Request 或 Cancel
+        std::vector<uint32_t> waiters;
+        waiters.swap(job->waiters);
+        for (uint32_t id : waiters)
+        {
+            auto it = requests_.find(id);
+            if (it == requests_.end())
+            {
+                continue;
+            }
+
+            Callback callback = std::move(it->second.callback);
+            requests_.erase(it);
+            if (callback)
+            {
+                callback(job->result, job->path);
+            }
+            ++count;
+        }
+    }
+    return count;
+}
+
+// 线程池中执行：每个任务按提交顺序计算一个请求
+void PathService::__Run(const std::shared_ptr<State> &state)
+{
+    std::unique_ptr<Context> context;
+    {
+        std::lock_guard<std::mutex> guard(state->mutex);
+        if (state->closed)
+        {
+            return;
+        }
+        if (!state->contexts.empty())
+        {
+            context = std::move(state->contexts.back());
+            state->contexts.pop_back();
+        }
+        ++state->running;
+    }
+
+    // 线程池的线程比预先创建的上下文多
+    if (!context)
+    {
+        context.reset(new Context());
+        context->param = state->param;
+    }
+
+    std::shared_ptr<Job> job;
+    if (state->pending.TryTake(job))
+    {
+        if (!job->cancelled)
+        {
+            context->param.start = job->start;
+            context->param.end = job->end;
+            if (context->search.Start(context->param))
+            {
+                // 分片执行，请求取消或服务析构后不再继续，结果保持 STEP_FAILED；
+                // 上下文照常放回，下一个请求 Start 时会清空留下的开启列表
+                AStar::StepResult result = AStar::STEP_PENDING;
+                while (result == AStar::STEP_PENDING && !job->cancelled && !state->closed)
+                {
+                    result = context->search.Step(kSliceSize);
+                }
+
+                if (result != AStar::STEP_PENDING)
+                {
+                    job->result = result;
+                    job->path = context->search.GetPath();
+                }
+            }
+        }
+        state->done.Put(std::move(job));
+    }
+
+    std::lock_guard<std::mutex> guard(state->mutex);
+    state->contexts.push_back(std::move(context));
+    --state->running;
+    state->idle.notify_all();
+}
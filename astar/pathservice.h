@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "astar/astar.h"
+
+namespace vtw
+{
+class ThreadPool;
+}
+
+/**
+* 异步寻路服务
+*
+* 逻辑线程调用 Request 提交请求后立即返回，请求在 vtw::ThreadPool 的线程中计算，
+* 每个线程使用独立的搜索上下文。完成的结果先放入队列，逻辑线程每帧调用 Dispatch 时回调，
+* 回调总是在逻辑线程中执行，寻路耗时不会阻塞逻辑帧。
+*
+* 起点和终点都相同的请求在计算完成前只计算一次，结果回调给所有请求。
+* Cancel 取消不再需要的请求，同一次计算的请求都取消后，尚未开始的计算直接跳过，
+* 正在进行的计算每扩展一段节点检查一次，随后停止。
+*
+* 除构造函数外所有接口都只能在逻辑线程中调用。
+* 地图参数在所有请求之间共享，寻路期间地图必须只读，canPass 必须可以被多个线程同时调用。
+* 析构时正在进行的计算随即停止，等它们退出后返回，尚未开始的计算不再读取地图。
+*/
+
+class PathService final
+{
+public:
+    /**
+     * 寻路结束时的回调，result 为 STEP_FOUND、STEP_PARTIAL 或 STEP_FAILED
+     */
+    using Callback = std::function<void(AStar::StepResult result, const std::vector<AStar::Vec2> &path)>;
+
+public:
+    /**
+     * 预先创建 threadNum 个搜索上下文，通常为 pool 中的线程数，不够时按需创建
+     * pool 的生命周期必须长于 PathService，有未回调的请求时不能停止 pool
+     * param 中的 start 和 end 被忽略
+     */
+    PathService(vtw::ThreadPool &pool, size_t threadNum, const AStar::Params &param);
+    ~PathService();
+
+    /**
+     * 提交寻路请求，返回请求 id，起点或终点在地图外、参数设置了 chunkGrid 或 pool 已停止时返回 0 且不会回调
+     */
+    uint32_t Request(const AStar::Vec2 &start, const AStar::Vec2 &end, const Callback &callback);
+
+    /**
+     * 取消未回调的请求，不会回调
+     */
+    bool Cancel(uint32_t id);
+
+    /**
+     * 回调已完成的请求，返回回调的次数
+     */
+    size_t Dispatch();
+
+    /**
+     * 已提交但还未回调的请求数
+     */
+    size_t GetPendingCount() const { return requests_.size(); }
+
+    /**
+     * 正在计算或等待计算的不同请求数，起点和终点相同的请求只算一个
+     */
+    size_t GetInFlightCount() const { return inFlight_.size(); }
+
+private:
+    struct Job;
+    struct Context;
+    struct State;
+
+    struct PendingRequest
+    {
+        std::shared_ptr<Job> job;
+        Callback callback;
+    };
+
+    static uint64_t __MakeKey(const AStar::Vec2 &start, const AStar::Vec2 &end);
+    static void __Run(const std::shared_ptr<State> &state);
+
+private:
+    vtw::ThreadPool &pool_;
+    uint16_t width_;
+    uint16_t height_;
+    std::shared_ptr<State> state_; // 与线程池中的任务共享
+    uint32_t nextId_;
+    std::unordered_map<uint32_t, PendingRequest> requests_; // 未回调的请求
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> inFlight_; // 按起点和终点去重的未完成计算
+};
@@ -0,0 +1,229 @@
+﻿#include <assert.h>
+#include "astar/regionindex.h"
+
+// 可通过但还未分配区域的格子
+static const uint32_t kUnassigned = UINT32_MAX;
+
+static const int kDirX[4] = { 1, -1, 0, 0 };
+static const int kDirY[4] = { 0, 0, 1, -1 };
+
+// 周围一圈的8个格子，按顺时针排列，相邻两个格子互相连通
+static const int kRingX[8] = { -1, 0, 1, 1, 1, 0, -1, -1 };
+static const int kRingY[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
+
+RegionIndex::RegionIndex() :
+    width_(0),
+    height_(0)
+{
+}
+
+RegionIndex::~RegionIndex()
+{
+}
+
+void RegionIndex::Build(uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass)
+{
+    width_ = width;
+    height_ = height;
+    canPass_ = canPass;
+    labels_.assign((size_t)width_ * height_, 0);
+    roots_.assign(1, 0);
+
+    // 先把可通过的格子标记为未分配，再逐个区域分配标记
+    for (uint16_t y = 0; y < height_; ++y)
+    {
+        for (uint16_t x = 0; x < width_; ++x)
+        {
+            if (CanPass(x, y))
+            {
+                labels_[(size_t)y * width_ + x] = kUnassigned;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < labels_.size(); ++i)
+    {
+        if (labels_[i] == kUnassigned)
+        {
+            Flood((int)(i % width_), (int)(i / width_), NewLabel());
+        }
+    }
+}
+
+void RegionIndex::Update(const std::vector<AStar::Vec2> &changedCells)
+{
+    // 逐个处理变化的格子，除了当前格子外只看标记而不读取地图，
+    // 每一步面对的都是处理完前面变化后的地图，不会被同一批中尚未处理的变化干扰
+    for (const auto &cell : changedCells)
+    {
+        assert(cell.x < width_ && cell.y < height_);
+        const bool passable = CanPass(cell.x, cell.y);
+        const bool labeled = labels_[(size_t)cell.y * width_ + cell.x] != 0;
+        if (passable && !labeled)
+        {
+            OpenCell(cell.x, cell.y);
+        }
+        else if (!passable && labeled)
+        {
+            BlockCell(cell.x, cell.y);
+        }
+    }
+
+    // 标记数超过格子数时说明废弃的标记太多，重新标记整张地图
+    if (roots_.size() > labels_.size() + 1)
+    {
+        Build(width_, height_, canPass_);
+        return;
+    }
+
+    // 压平并查集，查询时不需要再向上查找
+    for (uint32_t label = 0; label < roots_.size(); ++label)
+    {
+        roots_[label] = FindRoot(label);
+    }
+}
+
+bool RegionIndex::CanPass(int x, int y) const
+{
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? canPass_(AStar::Vec2(x, y)) : false;
+}
+
+bool RegionIndex::IsLabeled(int x, int y) const
+{
+    return (x >= 0 && x < width_ && y >= 0 && y < height_) ? labels_[(size_t)y * width_ + x] != 0 : false;
+}
+
+uint32_t RegionIndex::FindRoot(uint32_t label)
+{
+    while (roots_[label] != label)
+    {
+        roots_[label] = roots_[roots_[label]];
+        label = roots_[label];
+    }
+    return label;
+}
+
+uint32_t RegionIndex::NewLabel()
+{
+    const uint32_t label = (uint32_t)roots_.size();
+    roots_.push_back(label);
+    return label;
+}
+
+// 从(x,y)开始把4方向连通的有标记格子改为 label
+void RegionIndex::Flood(int x, int y, uint32_t label)
+{
+    labels_[(size_t)y * width_ + x] = label;
+    queue_.clear();
+    queue_.push_back((uint32_t)y * width_ + x);
+    for (size_t head = 0; head < queue_.size(); ++head)
+    {
+        const int cx = queue_[head] % width_;
+        const int cy = queue_[head] / width_;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const int nx = cx + kDirX[dir];
+            const int ny = cy + kDirY[dir];
+            if (nx >= 0 && nx < width_ && ny >= 0 && ny < height_)
+            {
+                uint32_t &neighbor = labels_[(size_t)ny * width_ + nx];
+                if (neighbor != 0 && neighbor != label)
+                {
+                    neighbor = label;
+                    queue_.push_back((uint32_t)ny * width_ + nx);
+                }
+            }
+        }
+    }
+}
+
+// 新的可通过格子把相邻的区域合并为一个
+void RegionIndex::OpenCell(int x, int y)
+{
+    uint32_t root = 0;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        const int nx = x + kDirX[dir];
+        const int ny = y + kDirY[dir];
+        if (nx < 0 || nx >= width_ || ny < 0 || ny >= height_)
+        {
+            continue;
+        }
+
+        const uint32_t label = labels_[(size_t)ny * width_ + nx];
+        if (label == 0)
+        {
+            continue;
+        }
+
+        const uint32_t other = FindRoot(label);
+        if (root == 0)
+        {
+            root = other;
+        }
+        else if (other != root)
+        {
+            roots_[other] = root;
+        }
+    }
+
+    labels_[(size_t)y * width_ + x] = root != 0 ? root : NewLabel();
+}
+
+// 格子变为不可通过，区域可能被分割
+void RegionIndex::BlockCell(int x, int y)
+{
+    labels_[(size_t)y * width_ + x] = 0;
+
+    // 周围一圈上连续的可通过格子是连通的，
+    // 如果所有可通过的正交相邻格子都在同一段上，区域不会被分割
+    bool pass[8];
+    int start = -1;
+    for (int i = 0; i < 8; ++i)
+    {
+        pass[i] = IsLabeled(x + kRingX[i], y + kRingY[i]);
+        if (!pass[i])
+        {
+            start = i;
+        }
+    }
+
+    if (start < 0)
+    {
+        return;
+    }
+
+    // 从不可通过的格子之后开始绕一圈，统计含有正交相邻格子的段数，奇数位置是正交相邻的格子
+    int segments = 0;
+    bool counted = false;
+    for (int k = 1; k <= 8; ++k)
+    {
+        const int i = (start + k) % 8;
+        if (!pass[i])
+        {
+            counted = false;
+        }
+        else if ((i & 1) && !counted)
+        {
+            ++segments;
+            counted = true;
+        }
+    }
+
+    if (segments <= 1)
+    {
+        return;
+    }
+
+    // 可能被分割，从每个正交相邻格子重新标记
+    const uint32_t firstLabel = (uint32_t)roots_.size();
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        const int nx = x + kDirX[dir];
+        const int ny = y + kDirY[dir];
+        if (IsLabeled(nx, ny) && labels_[(size_t)ny * width_ + nx] < firstLabel)
+        {
+            Flood(nx, ny, NewLabel());
+        }
+    }
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+#include <stdint.h>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 连通区域索引
+*
+* 给每个可通过的格子标记所在连通区域，判断两个格子是否连通只需比较两次数组读取的结果。
+* 设置到 AStar::Params::regionIndex 后，起点和终点不连通时寻路不扩展任何节点直接失败，
+* 避免遍历整个可达区域。设置了 maxExpansions 或 maxRadius 时不做这个判断，仍然返回部分路径。
+*
+* 不能穿过拐角时，斜角移动的两侧格子必然可通过，所以4方向和8方向的连通区域相同，
+* 同一个索引可以用于 corner 为 true 或 false 的寻路。
+*
+* 地图变化后调用 Update 增量维护：
+* 格子变为可通过时用并查集合并相邻区域；
+* 格子变为不可通过时，若相邻格子在它周围一圈上仍然相连则无需处理，否则重新标记原区域。
+*/
+
+class RegionIndex final
+{
+public:
+    RegionIndex();
+    ~RegionIndex();
+
+    /**
+     * 标记整张地图的连通区域
+     * canPass 会被保存，Update 时用来读取地图
+     */
+    void Build(uint16_t width, uint16_t height, const AStar::CanPassFunc &canPass);
+
+    /**
+     * 地图格子变化后更新索引
+     */
+    void Update(const std::vector<AStar::Vec2> &changedCells);
+
+    uint16_t GetWidth() const { return width_; }
+    uint16_t GetHeight() const { return height_; }
+
+    /**
+     * 返回 false 表示从 start 一定无法到达 end
+     * start 不可通过时无法判断，返回 true
+     */
+    bool IsConnected(const AStar::Vec2 &start, const AStar::Vec2 &end) const
+    {
+        if (start == end)
+        {
+            return true;
+        }
+
+        const uint32_t from = labels_[(size_t)start.y * width_ + start.x];
+        const uint32_t to = labels_[(size_t)end.y * width_ + end.x];
+        if (to == 0)
+        {
+            return false;
+        }
+        return from == 0 || roots_[from] == roots_[to];
+    }
+
+private:
+    bool CanPass(int x, int y) const;
+    bool IsLabeled(int x, int y) const;
+    uint32_t FindRoot(uint32_t label);
+    uint32_t NewLabel();
+    void Flood(int x, int y, uint32_t label);
+
+    void OpenCell(int x, int y);
+    void BlockCell(int x, int y);
+
+private:
+    uint16_t width_;
+    uint16_t height_;
+    AStar::CanPassFunc canPass_;
+    std::vector<uint32_t> labels_; // 每个格子的区域标记，0 表示不可通过
+    std::vector<uint32_t> roots_; // 并查集，Update 结束后每个标记都直接指向根
+    std::vector<uint32_t> queue_; // Flood 使用的队列
+};
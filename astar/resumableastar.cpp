@@ -0,0 +1,139 @@
+﻿#include <assert.h>
+#include "astar/resumableastar.h"
+#include "astar/basicastar.h"
+
+class ResumableAStar::Searcher
+{
+public:
+    virtual ~Searcher() {}
+    virtual bool Start(const AStar::Params &param) = 0;
+    virtual AStar::StepResult Step(size_t maxExpansions, std::vector<AStar::Vec2> *outPaths) = 0;
+    virtual size_t GetExpandedCount() const = 0;
+};
+
+// 同时持有可通过性判断和 BasicAStar，保证 BasicAStar 引用的对象与搜索同生命周期
+template<typename CanPass, typename MovePolicy, typename Heuristic>
+class ResumableAStar::SearcherImpl final : public ResumableAStar::Searcher
+{
+public:
+    SearcherImpl(AStar::SearchSpace &space, AStar::SearchSpace &backSpace, const CanPass &canPass)
+        : canPass_(canPass), astar_(space, canPass_, &backSpace)
+    {
+    }
+
+    bool Start(const AStar::Params &param) override
+    {
+        return astar_.Start(param);
+    }
+
+    AStar::StepResult Step(size_t maxExpansions, std::vector<AStar::Vec2> *outPaths) override
+    {
+        return astar_.Step(maxExpansions, outPaths);
+    }
+
+    size_t GetExpandedCount() const override
+    {
+        return astar_.GetExpandedCount();
+    }
+
+private:
+    CanPass canPass_;
+    BasicAStar<CanPass, MovePolicy, Heuristic> astar_;
+};
+
+ResumableAStar::ResumableAStar() :
+    result_(AStar::STEP_FAILED)
+{
+}
+
+ResumableAStar::~ResumableAStar()
+{
+}
+
+bool ResumableAStar::Start(const AStar::Params &param)
+{
+    searcher_.reset();
+    path_.clear();
+    result_ = AStar::STEP_FAILED;
+    if (!param.IsValid() || !param.IsMapMatched())
+    {
+        assert(false);
+        return false;
+    }
+
+    param_ = param;
+    if (param_.costGrid)
+    {
+        CreateLayeredSearcher(CostGridCanPass(*param_.costGrid));
+    }
+    else if (param_.chunkGrid)
+    {
+        CreateLayeredSearcher(ChunkedGridCanPass(*param_.chunkGrid));
+    }
+    else if (param_.passGrid)
+    {
+        CreateLayeredSearcher(BitGridCanPass(*param_.passGrid));
+    }
+    else
+    {
+        CreateLayeredSearcher(CallbackCanPass<AStar::CanPassFunc>(param_.canPass, param_.width, param_.height));
+    }
+
+    if (!searcher_->Start(param_))
+    {
+        searcher_.reset();
+        return false;
+    }
+
+    result_ = AStar::STEP_PENDING;
+    return true;
+}
+
+AStar::StepResult ResumableAStar::Step(size_t maxExpansions)
+{
+    if (result_ == AStar::STEP_PENDING)
+    {
+        result_ = searcher_->Step(maxExpansions, &path_);
+    }
+    return result_;
+}
+
+size_t ResumableAStar::GetExpandedCount() const
+{
+    return searcher_ ? searcher_->GetExpandedCount() : 0;
+}
+
+// 设置了占用层时叠加到静态地图上
+template<typename CanPass>
+void ResumableAStar::CreateLayeredSearcher(const CanPass &canPass)
+{
+    if (param_.occupancy)
+    {
+        CreateSearcher(OccupancyCanPass<CanPass>(canPass, *param_.occupancy, param_));
+    }
+    else
+    {
+        CreateSearcher(canPass);
+    }
+}
+
+template<typename CanPass>
+void ResumableAStar::CreateSearcher(const CanPass &canPass)
+{
+    if (param_.corner)
+    {
+        CreateSearcher<CanPass, EightWayMove>(canPass);
+    }
+    else
+    {
+        CreateSearcher<CanPass, FourWayMove>(canPass);
+    }
+}
+
+template<typename CanPass, typename MovePolicy>
+void ResumableAStar::CreateSearcher(const CanPass &canPass)
+{
+    DispatchHeuristic<MovePolicy>(param_.heuristic, [&](auto heuristic) {
+        searcher_.reset(new SearcherImpl<CanPass, MovePolicy, decltype(heuristic)>(space_, backSpace_, canPass));
+    });
+}
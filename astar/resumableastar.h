@@ -0,0 +1,65 @@
+﻿#pragma once
+#include <stddef.h>
+#include <memory>
+#include <vector>
+#include "astar/astar.h"
+
+/**
+* 可分步执行的A星寻路
+*
+* 每次 Step 最多扩展指定数量的节点，开启列表和节点状态保存在对象内部，
+* 下次 Step 从中断处继续，用于把一次长距离寻路分摊到多帧。
+* 每个对象拥有独立的搜索空间，同时进行的搜索需要各自的对象。
+* 搜索结果与 AStar::Find 相同。
+*/
+
+class ResumableAStar final
+{
+public:
+    ResumableAStar();
+    ~ResumableAStar();
+
+    /**
+     * 开始新的搜索，param 会被复制保存
+     * 参数错误时返回 false，此时 GetResult 为 STEP_FAILED
+     */
+    bool Start(const AStar::Params &param);
+
+    /**
+     * 最多扩展 maxExpansions 个节点
+     * 搜索已经结束时直接返回结果
+     */
+    AStar::StepResult Step(size_t maxExpansions);
+
+    AStar::StepResult GetResult() const { return result_; }
+
+    /**
+     * 找到的路径，格式与 AStar::Find 一致，仅在 STEP_FOUND 或 STEP_PARTIAL 后有效
+     */
+    const std::vector<AStar::Vec2>& GetPath() const { return path_; }
+
+    /**
+     * 本次搜索累计扩展的节点数
+     */
+    size_t GetExpandedCount() const;
+
+private:
+    class Searcher;
+    template<typename CanPass, typename MovePolicy, typename Heuristic>
+    class SearcherImpl;
+
+    template<typename CanPass>
+    void CreateLayeredSearcher(const CanPass &canPass);
+    template<typename CanPass>
+    void CreateSearcher(const CanPass &canPass);
+    template<typename CanPass, typename MovePolicy>
+    void CreateSearcher(const CanPass &canPass);
+
+private:
+    AStar::Params param_;
+    AStar::SearchSpace space_;
+    AStar::SearchSpace backSpace_; // 双向搜索使用
+    std::unique_ptr<Searcher> searcher_; // 按 Params 选择的 BasicAStar 实例
+    AStar::StepResult result_;
+    std::vector<AStar::Vec2> path_;
+};
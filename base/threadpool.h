@@ -39,6 +39,9 @@ public:
 
     void Stop() { _stop = true; }
 
+    // 停止后 AddTask 不再接受任务，已在队列中的任务也可能不再执行
+    bool IsStopped() const { return _stop; }
+
     void AddTask(const Task& t)
     {
         if (!_stop)
@@ -4,7 +4,11 @@
 int main(int argc, char* argv[])
 {
     //Test_AStar();
+    //Test_AStarBench();
     //Test_ByteBuffer();
+    //Test_DStarLite();
+    //Test_FlowField();
+    //Test_HPAStar();
     //Test_LibCurl();
     //Test_LibUv();
     //Test_TimeWheel();
@@ -1,7 +1,11 @@
 ﻿#pragma once
 
 void Test_AStar();
+void Test_AStarBench();
 void Test_ByteBuffer();
+void Test_DStarLite();
+void Test_FlowField();
+void Test_HPAStar();
 void Test_LibCurl();
 void Test_LibUv();
 void Test_TimeWheel();
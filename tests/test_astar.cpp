@@ -1,6 +1,21 @@
-﻿#include "tests/test.h"
+﻿#include <chrono>
+#include <thread>
+#include "tests/test.h"
 
 #include "astar/astar.h"
+#include "astar/bitgrid.h"
+#include "astar/chunkedgrid.h"
+#include "astar/costgrid.h"
+#include "astar/jumptable.h"
+#include "astar/landmarktable.h"
+#include "astar/occupancygrid.h"
+#include "astar/pathbatch.h"
+#include "astar/pathcache.h"
+#include "astar/pathscheduler.h"
+#include "astar/pathservice.h"
+#include "astar/regionindex.h"
+#include "astar/resumableastar.h"
+#include "base/threadpool.h"
 
 void Test_AStar()
 {
@@ -49,4 +64,229 @@ void Test_AStar()
         ++steps;
         printf("%2d: %u,%u\n", steps, pos.x, pos.y);
     }
+
+    // 跳点搜索，路径长度应与普通A星一致
+    param.mode = AStar::SEARCH_JPS;
+    printf("JPS steps: %u\n", (unsigned)algorithm.Find(param).size());
+
+    JumpTable jumpTable;
+    jumpTable.Build(param.width, param.height, param.corner, param.canPass);
+    param.mode = AStar::SEARCH_JPS_PLUS;
+    param.jumpTable = &jumpTable;
+    printf("JPS+ steps: %u\n", (unsigned)algorithm.Find(param).size());
+
+    // 使用按位存储的可通过性网格代替 canPass
+    BitGrid passGrid;
+    passGrid.Build(param.width, param.height, param.canPass);
+    param.mode = AStar::SEARCH_ASTAR;
+    param.passGrid = &passGrid;
+    printf("BitGrid steps: %u\n", (unsigned)algorithm.Find(param).size());
+
+    // 按f值分桶的开启列表
+    param.openList = AStar::OPENLIST_BUCKET;
+    printf("Bucket steps: %u\n", (unsigned)algorithm.Find(param).size());
+
+    // 双向搜索
+    param.mode = AStar::SEARCH_BIDIRECTIONAL;
+    printf("Bidirectional steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.mode = AStar::SEARCH_ASTAR;
+
+    // 只返回拐点
+    param.smooth = true;
+    printf("Smooth waypoints: %u\n", (unsigned)algorithm.Find(param).size());
+    param.smooth = false;
+
+    // 地标估价，距离表保存到文件后再读回使用
+    LandmarkTable landmarks;
+    landmarks.Build(param.width, param.height, param.corner, param.canPass, 4);
+    landmarks.Save("vtw_landmarks.bin");
+    LandmarkTable loadedLandmarks;
+    if (loadedLandmarks.Load("vtw_landmarks.bin"))
+    {
+        param.landmarks = &loadedLandmarks;
+        printf("Landmarks steps: %u\n", (unsigned)algorithm.Find(param).size());
+        param.landmarks = nullptr;
+    }
+    remove("vtw_landmarks.bin");
+
+    // 允许斜角时默认使用对角距离估价，也可以指定其他估价函数
+    param.corner = true;
+    printf("Octile steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.heuristic = AStar::HEURISTIC_EUCLIDEAN;
+    printf("Euclidean steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.heuristic = AStar::HEURISTIC_AUTO;
+    param.corner = false;
+
+    // 地形代价，第7行是代价为3倍的沼泽
+    CostGrid costGrid;
+    costGrid.Build(param.width, param.height, [&](const AStar::Vec2 &pos) {
+        if (map[pos.y][pos.x] != 0)
+        {
+            return CostGrid::kBlocked;
+        }
+        return pos.y == 7 ? (uint8_t)(CostGrid::kDefaultCost * 3) : CostGrid::kDefaultCost;
+    });
+    param.costGrid = &costGrid;
+    printf("CostGrid steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.costGrid = nullptr;
+
+    // 多个终点，一次搜索找到最近的一个
+    std::vector<AStar::Vec2> goals = { AStar::Vec2(9, 9), AStar::Vec2(0, 9), AStar::Vec2(9, 0) };
+    auto nearest = algorithm.FindNearest(param, goals);
+    printf("Nearest goal: %u,%u, steps: %u\n", nearest.back().x, nearest.back().y, (unsigned)nearest.size());
+
+    // 限制搜索半径，返回朝终点前进的部分路径
+    param.maxRadius = 4;
+    auto partial = algorithm.Find(param);
+    printf("Partial path end: %u,%u, steps: %u\n", partial.back().x, partial.back().y, (unsigned)partial.size());
+    param.maxRadius = 0;
+
+    // 动态占用层，单位堵住唯一的通道时不可达，只考虑起点附近的单位时不受影响
+    OccupancyGrid occupancy;
+    occupancy.Reset(param.width, param.height);
+    occupancy.Set(4, 5, true);
+    param.occupancy = &occupancy;
+    printf("Occupancy steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.occupancyRadius = 3;
+    printf("Occupancy radius 3 steps: %u\n", (unsigned)algorithm.Find(param).size());
+    param.occupancy = nullptr;
+    param.occupancyRadius = 0;
+
+    // 分块加载的地图，块在第一次访问时才读入
+    ChunkedGrid chunkGrid;
+    chunkGrid.Reset(param.width, param.height, 1, [&](uint16_t chunkX, uint16_t chunkY, uint64_t *rows) {
+        for (int y = 0; y < param.height; ++y)
+        {
+            for (int x = 0; x < param.width; ++x)
+            {
+                rows[y] |= (uint64_t)(map[y][x] == 0) << x;
+            }
+        }
+        return true;
+    });
+    param.chunkGrid = &chunkGrid;
+    printf("ChunkedGrid steps: %u\n", (unsigned)algorithm.Find(param).size());
+    printf("ChunkedGrid loaded: %u\n", (unsigned)chunkGrid.GetLoadedCount());
+    param.chunkGrid = nullptr;
+
+    // 路径缓存，重复请求直接返回缓存的路径，路径包围盒内的格子变化后重新搜索
+    PathCache cache(16);
+    cache.Find(algorithm, param);
+    cache.Find(algorithm, param);
+    cache.Invalidate({ AStar::Vec2(9, 0) });
+    auto cached = cache.Find(algorithm, param);
+    printf("PathCache steps: %u, hit rate: %.2f, size: %u\n",
+        (unsigned)cached.size(), cache.GetHitRate(), (unsigned)cache.GetSize());
+
+    // 批量寻路，结果按请求顺序返回
+    vtw::ThreadPool pool(2);
+    PathBatch batch(pool, 2);
+    std::vector<PathBatch::Query> queries(64);
+    for (size_t i = 0; i < queries.size(); ++i)
+    {
+        queries[i].start = (i & 1) ? AStar::Vec2(9, 9) : AStar::Vec2(0, 0);
+        queries[i].end = (i & 1) ? AStar::Vec2(0, 0) : AStar::Vec2(9, 9);
+    }
+    std::vector<PathBatch::Result> results;
+    batch.FindBatch(param, queries, &results);
+    printf("Batch steps: %u %u\n", (unsigned)results[0].size(), (unsigned)results[1].size());
+
+    // 异步寻路服务，相同起终点的请求只计算一次，取消的请求不会回调
+    {
+        PathService service(pool, 2, param);
+        int callbacks = 0;
+        auto callback = [&](AStar::StepResult result, const std::vector<AStar::Vec2> &path) {
+            ++callbacks;
+            printf("PathService steps: %u\n", (unsigned)path.size());
+        };
+        service.Request(param.start, param.end, callback);
+        service.Request(param.start, param.end, callback);
+        service.Cancel(service.Request(param.end, param.start, callback));
+        printf("PathService in flight: %u\n", (unsigned)service.GetInFlightCount());
+        while (service.GetPendingCount() > 0)
+        {
+            service.Dispatch();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        printf("PathService callbacks: %d\n", callbacks);
+    }
+
+    // 取消正在计算的长请求，之后的请求复用同一个上下文
+    {
+        AStar::Params large;
+        large.width = 1024;
+        large.height = 1024;
+        large.canPass = [](const AStar::Vec2 &pos) {
+            return pos.x != 1000; // 竖墙把地图分成两半，终点不可达时要遍历整个左半边
+        };
+        PathService service(pool, 1, large);
+        uint32_t id = service.Request(AStar::Vec2(0, 0), AStar::Vec2(1020, 0), nullptr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        service.Cancel(id);
+        service.Request(AStar::Vec2(0, 0), AStar::Vec2(20, 20), [&](AStar::StepResult result, const std::vector<AStar::Vec2> &path) {
+            printf("PathService after cancel steps: %u\n", (unsigned)path.size());
+        });
+        while (service.GetPendingCount() > 0)
+        {
+            service.Dispatch();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    pool.Stop();
+
+    // 线程池停止后批量寻路在调用线程中完成
+    batch.FindBatch(param, queries, &results);
+    printf("Batch after stop steps: %u %u\n", (unsigned)results[0].size(), (unsigned)results[1].size());
+
+    // 分帧寻路，每帧共扩展 20 个节点
+    PathScheduler scheduler(20);
+    int frames = 0;
+    scheduler.Add(param, [&](AStar::StepResult result, const std::vector<AStar::Vec2> &path) {
+        printf("Scheduler steps: %u, frames: %d\n", (unsigned)path.size(), frames);
+    });
+    while (scheduler.GetPendingCount() > 0)
+    {
+        ++frames;
+        scheduler.Update();
+    }
+
+    // 取消搜索到一半的请求，复用它的搜索空间的下一个请求不受影响
+    uint32_t cancelled = scheduler.Add(param, nullptr);
+    scheduler.Update();
+    scheduler.Cancel(cancelled);
+    AStar::Params reversed = param;
+    std::swap(reversed.start, reversed.end);
+    scheduler.Add(reversed, [&](AStar::StepResult result, const std::vector<AStar::Vec2> &path) {
+        printf("Scheduler after cancel steps: %u\n", (unsigned)path.size());
+    });
+    while (scheduler.GetPendingCount() > 0)
+    {
+        scheduler.Update();
+    }
+
+    // 中途放弃的搜索不影响同一对象上的下一次搜索
+    ResumableAStar resumable;
+    reversed.openList = AStar::OPENLIST_BUCKET;
+    resumable.Start(param);
+    resumable.Step(5);
+    resumable.Start(reversed);
+    while (resumable.Step(20) == AStar::STEP_PENDING)
+    {
+    }
+    printf("Restarted search steps: %u\n", (unsigned)resumable.GetPath().size());
+
+    // 连通区域索引，堵住唯一的通道后终点不可达，寻路直接失败
+    RegionIndex regionIndex;
+    regionIndex.Build(param.width, param.height, param.canPass);
+    param.regionIndex = &regionIndex;
+    map[5][4] = 1;
+    passGrid.Set(4, 5, false);
+    regionIndex.Update({ AStar::Vec2(4, 5) });
+    printf("RegionIndex connected: %d, steps: %u\n",
+        (int)regionIndex.IsConnected(param.start, param.end), (unsigned)algorithm.Find(param).size());
+
+    // 设置了搜索限制时不连通也返回部分路径
+    param.maxExpansions = 20;
+    partial = algorithm.Find(param);
+    printf("RegionIndex partial path end: %u,%u, steps: %u\n", partial.back().x, partial.back().y, (unsigned)partial.size());
 }
@@ -0,0 +1,153 @@
+﻿#include "tests/test.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "astar/bitgrid.h"
+#include "astar/resumableastar.h"
+#include "base/tick.h"
+
+// 在 4096x4096 的地图上比较节点数组按行平铺和分块存放的耗时
+// 两种布局扩展的节点完全相同，耗时差异来自缓存和 TLB 未命中
+static void Bench_NodeLayout()
+{
+    const uint16_t width = 4096;
+    const uint16_t height = 4096;
+    const int queryCount = 10;
+
+    struct Layout
+    {
+        const char *name;
+        AStar::NodeLayout layout;
+    };
+    const Layout layouts[] =
+    {
+        { "row-major", AStar::LAYOUT_ROW_MAJOR },
+        { "tiled", AStar::LAYOUT_TILED },
+    };
+
+    srand(12345);
+    BitGrid passGrid;
+    passGrid.Reset(width, height);
+    for (uint16_t y = 0; y < height; ++y)
+    {
+        for (uint16_t x = 0; x < width; ++x)
+        {
+            passGrid.Set(x, y, (rand() % 100) >= 20);
+        }
+    }
+
+    std::vector<AStar::Vec2> points;
+    for (int i = 0; i < queryCount * 2; ++i)
+    {
+        AStar::Vec2 pos(rand() % width, rand() % height);
+        passGrid.Set(pos.x, pos.y, true);
+        points.push_back(pos);
+    }
+
+    for (const Layout &layout : layouts)
+    {
+        AStar::Params param;
+        param.width = width;
+        param.height = height;
+        param.corner = true;
+        param.passGrid = &passGrid;
+        param.nodeLayout = layout.layout;
+
+        // 先搜索一次，分配节点数组的耗时不计入
+        ResumableAStar search;
+        param.start = param.end = points[0];
+        search.Start(param);
+        search.Step(SIZE_MAX);
+
+        size_t expanded = 0;
+        const int64_t start = vtw::GetTickCount();
+        for (int i = 0; i < queryCount; ++i)
+        {
+            param.start = points[i * 2];
+            param.end = points[i * 2 + 1];
+            search.Start(param);
+            search.Step(SIZE_MAX);
+            expanded += search.GetExpandedCount();
+        }
+        const int64_t elapsed = vtw::GetTickCount() - start;
+
+        printf("layout %-10s expanded %8u %5lld ms\n", layout.name, (unsigned)expanded, (long long)elapsed);
+    }
+}
+
+// 在随机地图上比较各种搜索方式扩展的节点数和耗时
+void Test_AStarBench()
+{
+    const uint16_t width = 1024;
+    const uint16_t height = 1024;
+    const int queryCount = 20;
+
+    struct Mode
+    {
+        const char *name;
+        AStar::SearchMode mode;
+    };
+    const Mode modes[] =
+    {
+        { "astar", AStar::SEARCH_ASTAR },
+        { "bidirectional", AStar::SEARCH_BIDIRECTIONAL },
+    };
+
+    std::vector<char> map((size_t)width * height);
+    for (int density = 0; density <= 30; density += 15)
+    {
+        srand(12345);
+        for (auto &cell : map)
+        {
+            cell = (rand() % 100) < density ? 1 : 0;
+        }
+
+        std::vector<AStar::Vec2> points;
+        for (int i = 0; i < queryCount * 2; ++i)
+        {
+            AStar::Vec2 pos(rand() % width, rand() % height);
+            map[(size_t)pos.y * width + pos.x] = 0;
+            points.push_back(pos);
+        }
+
+        for (int corner = 0; corner < 2; ++corner)
+        {
+            for (const Mode &mode : modes)
+            {
+                AStar::Params param;
+                param.width = width;
+                param.height = height;
+                param.corner = corner != 0;
+                param.mode = mode.mode;
+                param.canPass = [&](const AStar::Vec2 &pos) {
+                    return map[(size_t)pos.y * width + pos.x] == 0;
+                };
+
+                ResumableAStar search;
+                size_t expanded = 0;
+                size_t steps = 0;
+                int found = 0;
+                const int64_t start = vtw::GetTickCount();
+                for (int i = 0; i < queryCount; ++i)
+                {
+                    param.start = points[i * 2];
+                    param.end = points[i * 2 + 1];
+                    search.Start(param);
+                    if (search.Step(SIZE_MAX) == AStar::STEP_FOUND)
+                    {
+                        ++found;
+                    }
+                    expanded += search.GetExpandedCount();
+                    steps += search.GetPath().size();
+                }
+                const int64_t elapsed = vtw::GetTickCount() - start;
+
+                printf("density %2d%% corner %d %-14s found %2d steps %6u expanded %8u %5lld ms\n",
+                    density, corner, mode.name, found, (unsigned)steps, (unsigned)expanded, (long long)elapsed);
+            }
+        }
+    }
+
+    Bench_NodeLayout();
+}
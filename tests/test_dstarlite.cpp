@@ -0,0 +1,50 @@
+﻿#include "tests/test.h"
+
+#include <stdio.h>
+#include "astar/dstarlite.h"
+
+void Test_DStarLite()
+{
+    // 与 Test_AStar 相同的地图
+    char map[10][10] =
+    {
+        {0,1,0,0,0,1,0,0,0,0},
+        {0,0,0,1,0,1,0,1,0,1},
+        {1,1,1,1,0,1,0,1,0,1},
+        {0,0,0,1,0,0,0,1,0,1},
+        {0,1,0,1,1,1,1,1,0,1},
+        {0,1,0,0,0,0,0,0,0,1},
+        {0,1,1,1,1,1,1,1,1,1},
+        {0,0,0,0,1,0,0,0,1,0},
+        {1,1,0,0,1,0,1,0,0,0},
+        {0,0,0,0,0,0,1,0,1,0},
+    };
+
+    AStar::Params param;
+    param.width = 10;
+    param.height = 10;
+    param.corner = false;
+    param.start = AStar::Vec2(0, 0);
+    param.end = AStar::Vec2(9, 9);
+    param.canPass = [&](const AStar::Vec2 &pos) {
+        return map[pos.y][pos.x] == 0;
+    };
+
+    DStarLite planner;
+    planner.Init(param);
+    auto path = planner.Find();
+    printf("steps: %u, expanded: %u\n", (unsigned)path.size(), (unsigned)planner.GetExpandedCount());
+
+    // 沿路径走几步后堵住唯一的通道，终点变为不可达
+    planner.MoveStart(path[4]);
+    map[5][4] = 1;
+    planner.UpdateCells({ AStar::Vec2(4, 5) });
+    path = planner.Find();
+    printf("steps after block: %u, expanded: %u\n", (unsigned)path.size(), (unsigned)planner.GetExpandedCount());
+
+    // 重新打开通道
+    map[5][4] = 0;
+    planner.UpdateCells({ AStar::Vec2(4, 5) });
+    path = planner.Find();
+    printf("steps after reopen: %u, expanded: %u\n", (unsigned)path.size(), (unsigned)planner.GetExpandedCount());
+}
@@ -0,0 +1,44 @@
+﻿#include "tests/test.h"
+
+#include <stdio.h>
+#include "astar/flowfield.h"
+
+void Test_FlowField()
+{
+    // 与 Test_AStar 相同的地图
+    char map[10][10] =
+    {
+        {0,1,0,0,0,1,0,0,0,0},
+        {0,0,0,1,0,1,0,1,0,1},
+        {1,1,1,1,0,1,0,1,0,1},
+        {0,0,0,1,0,0,0,1,0,1},
+        {0,1,0,1,1,1,1,1,0,1},
+        {0,1,0,0,0,0,0,0,0,1},
+        {0,1,1,1,1,1,1,1,1,1},
+        {0,0,0,0,1,0,0,0,1,0},
+        {1,1,0,0,1,0,1,0,0,0},
+        {0,0,0,0,0,0,1,0,1,0},
+    };
+
+    FlowField field;
+    field.Build(10, 10, false, [&](const AStar::Vec2 &pos) {
+        return map[pos.y][pos.x] == 0;
+    });
+    field.SetTarget(AStar::Vec2(9, 9));
+
+    // 沿流场从左上角走到右下角
+    AStar::Vec2 pos(0, 0);
+    AStar::Vec2 next;
+    int steps = 0;
+    while (field.GetNext(pos, &next))
+    {
+        pos = next;
+        ++steps;
+    }
+    printf("steps: %d, distance: %d\n", steps, (int)field.GetDistance(AStar::Vec2(0, 0)));
+
+    // 目标移动一格，只更新距离变短的格子
+    field.MoveTarget(AStar::Vec2(9, 8));
+    printf("distance after move: %d, updated: %u\n",
+        (int)field.GetDistance(AStar::Vec2(0, 0)), (unsigned)field.GetUpdatedCount());
+}
@@ -0,0 +1,37 @@
+﻿#include "tests/test.h"
+
+#include <stdio.h>
+#include "astar/hpastar.h"
+
+void Test_HPAStar()
+{
+    // 与 Test_AStar 相同的地图，划分为 5x5 的簇
+    char map[10][10] =
+    {
+        {0,1,0,0,0,1,0,0,0,0},
+        {0,0,0,1,0,1,0,1,0,1},
+        {1,1,1,1,0,1,0,1,0,1},
+        {0,0,0,1,0,0,0,1,0,1},
+        {0,1,0,1,1,1,1,1,0,1},
+        {0,1,0,0,0,0,0,0,0,1},
+        {0,1,1,1,1,1,1,1,1,1},
+        {0,0,0,0,1,0,0,0,1,0},
+        {1,1,0,0,1,0,1,0,0,0},
+        {0,0,0,0,0,0,1,0,1,0},
+    };
+
+    HPAStar hpa;
+    hpa.Build(10, 10, false, 5, [&](const AStar::Vec2 &pos) {
+        return map[pos.y][pos.x] == 0;
+    });
+    printf("entrances: %u\n", (unsigned)hpa.GetEntranceCount());
+
+    auto path = hpa.Find(AStar::Vec2(0, 0), AStar::Vec2(9, 9));
+    printf("steps: %u\n", (unsigned)path.size());
+
+    // 堵住唯一的通道后只重建受影响的簇，终点变为不可达
+    map[5][4] = 1;
+    hpa.Update({ AStar::Vec2(4, 5) });
+    path = hpa.Find(AStar::Vec2(0, 0), AStar::Vec2(9, 9));
+    printf("steps after update: %u\n", (unsigned)path.size());
+}